@@ -11,6 +11,7 @@ PRECOMPILED_HEADER = src/precompiled.h
 
 QT += widgets
 QT += websockets
+QT += concurrent
 
 TARGET = safewallet
 
@@ -23,6 +24,9 @@ TEMPLATE = app
 DEFINES += \
     QT_DEPRECATED_WARNINGS
 
+# Compile in debug and info tracing (see src/trace.h) for debug builds only
+CONFIG(debug, debug|release): DEFINES += SAFE_TRACE
+
 INCLUDEPATH  += src/3rdparty/
 INCLUDEPATH  += src/
 mac: LIBS+= -Wl,-dead_strip
@@ -46,9 +50,14 @@ SOURCES += \
     src/3rdparty/qrcode/QrCode.cpp \
     src/3rdparty/qrcode/QrSegment.cpp \
     src/settings.cpp \
+    src/camount.cpp \
     src/sendtab.cpp \
     src/senttxstore.cpp \
+    src/historycache.cpp \
     src/txtablemodel.cpp \
+    src/txstore.cpp \
+    src/txsearch.cpp \
+    src/trace.cpp \
     src/qrcodelabel.cpp \
     src/connection.cpp \
     src/fillediconlabel.cpp \
@@ -72,8 +81,13 @@ HEADERS += \
     src/3rdparty/qrcode/QrCode.hpp \
     src/3rdparty/qrcode/QrSegment.hpp \
     src/settings.h \
+    src/camount.h \
     src/txtablemodel.h \
+    src/txstore.h \
+    src/txsearch.h \
+    src/trace.h \
     src/senttxstore.h \
+    src/historycache.h \
     src/qrcodelabel.h \
     src/connection.h \
     src/fillediconlabel.h \
@@ -86,7 +100,8 @@ HEADERS += \
     src/recurring.h \
     src/requestdialog.h \
     src/memoedit.h \
-    src/viewalladdresses.h 
+    src/viewalladdresses.h \
+    src/walletsnapshot.h
 
 FORMS += \
     src/mainwindow.ui \
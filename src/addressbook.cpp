@@ -31,14 +31,12 @@ void AddressBookModel::loadData() {
 }
 
 void AddressBookModel::addNewLabel(QString label, QString addr) {
-    //labels.push_back(QPair<QString, QString>(label, addr));
     AddressBook::getInstance()->addAddressLabel(label, addr);
 
-    labels.clear();
+    // The list is implicitly shared, so this doesn't copy it
+    beginResetModel();
     labels = AddressBook::getInstance()->getAllAddressLabels();
-
-    dataChanged(index(0, 0), index(labels.size()-1, columnCount(index(0,0))-1));
-    layoutChanged();
+    endResetModel();
 }
 
 void AddressBookModel::removeItemAt(int row) {
@@ -47,11 +45,9 @@ void AddressBookModel::removeItemAt(int row) {
 
     AddressBook::getInstance()->removeAddressLabel(labels[row].first, labels[row].second);
     
-    labels.clear();
+    beginResetModel();
     labels = AddressBook::getInstance()->getAllAddressLabels();
-
-    dataChanged(index(0, 0), index(labels.size()-1, columnCount(index(0,0))-1));
-    layoutChanged();
+    endResetModel();
 }
 
 QPair<QString, QString> AddressBookModel::itemAt(int row) {
@@ -90,6 +86,65 @@ QVariant AddressBookModel::headerData(int section, Qt::Orientation orientation,
 }
 
 
+void LabelCompletionFilter::setPattern(const QString& newPattern) {
+    if (pattern == newPattern)
+        return;
+
+    pattern = newPattern;
+    invalidateFilter();
+}
+
+bool LabelCompletionFilter::filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const {
+    if (pattern.isEmpty())
+        return true;
+
+    auto index = sourceModel()->index(sourceRow, 0, sourceParent);
+    auto key   = index.data(AddressBook::CompletionKeyRole).toString();
+    auto text  = index.data(AddressBook::CompletionTextRole).toString();
+
+    // Only the whole "label/address" key, so an entry isn't listed once for every word in it
+    if (key.compare(text, Qt::CaseInsensitive) != 0)
+        return false;
+
+    // The pattern's characters have to appear in the key in order, but not next to each other
+    int at = 0;
+    for (const auto& c : pattern) {
+        at = key.indexOf(c, at);
+        if (at < 0)
+            return false;
+        at++;
+    }
+    return true;
+}
+
+LabelCompleter::LabelCompleter(QAbstractItemModel* model, QObject* parent)
+    : QCompleter(parent) {
+    filter = new LabelCompletionFilter(this);
+    filter->setSourceModel(model);
+
+    setModel(filter);
+    setCompletionRole(AddressBook::CompletionKeyRole);
+    setCaseSensitivity(Qt::CaseInsensitive);
+    setModelSorting(QCompleter::CaseInsensitivelySortedModel);
+}
+
+QString LabelCompleter::pathFromIndex(const QModelIndex& index) const {
+    return index.data(AddressBook::CompletionTextRole).toString();
+}
+
+QStringList LabelCompleter::splitPath(const QString& path) const {
+    // Prefix matches are binary searched in the sorted keys. Only if there are none, filter the
+    // entries by the typed characters, and let the completer list everything that's left.
+    if (path.isEmpty() || AddressBook::getInstance()->hasCompletionsFor(path)) {
+        filter->setPattern(QString());
+        return QStringList(path);
+    }
+
+    filter->setPattern(path.toLower());
+    return QStringList(QString());
+}
+
+
 //===============
 // AddressBook
 //===============
@@ -256,14 +311,15 @@ AddressBook* AddressBook::getInstance() {
 }
 
 AddressBook::AddressBook() {
+    completionModel = new QStandardItemModel();
     readFromStorage();
 }
 
 void AddressBook::readFromStorage() {
     QFile file(AddressBook::writeableFile());
 
+    allLabels.clear();
     if (file.exists()) {
-        allLabels.clear();
         file.open(QIODevice::ReadOnly);
         QDataStream in(&file);    // read the data serialized from the file
         QString version;
@@ -272,6 +328,36 @@ void AddressBook::readFromStorage() {
         file.close();
     }
 
+    rebuildIndexes();
+
+    // Then apply the changes made since the file was written
+    journalRecords = 0;
+    bool journalOk = true;
+
+    QFile journal(journalFile());
+    if (journal.open(QIODevice::ReadOnly)) {
+        QDataStream in(&journal);
+        while (!in.atEnd()) {
+            quint8  op;
+            QString label, address, newLabel;
+            in >> op >> label >> address >> newLabel;
+
+            // A record that was cut short by a crash
+            if (in.status() != QDataStream::Ok) {
+                journalOk = false;
+                break;
+            }
+
+            applyJournalOp((JournalOp)op, label, address, newLabel);
+            journalRecords++;
+        }
+        journal.close();
+    }
+
+    // Nothing can be appended after a broken record, so start a new journal
+    if (!journalOk || journalRecords > maxJournalRecords)
+        writeToStorage();
+
     // Special. 
     // Add the default SafeWallet donation address if it isn't already present
     // QList<QString> allAddresses;
@@ -283,11 +369,16 @@ void AddressBook::readFromStorage() {
 }
 
 void AddressBook::writeToStorage() {
-    QFile file(AddressBook::writeableFile());
-    file.open(QIODevice::ReadWrite | QIODevice::Truncate);
+    QSaveFile file(AddressBook::writeableFile());
+    file.open(QIODevice::WriteOnly);
     QDataStream out(&file);   // we will serialize the data into the file
     out << QString("v1") << allLabels;
-    file.close();
+
+    // Everything in the journal is in the file now
+    if (file.commit()) {
+        QFile::remove(journalFile());
+        journalRecords = 0;
+    }
 }
 
 QString AddressBook::writeableFile() {
@@ -304,46 +395,203 @@ QString AddressBook::writeableFile() {
     }
 }
 
+QString AddressBook::journalFile() {
+    return writeableFile() % ".journal";
+}
 
-// Add a new address/label to the database
-void AddressBook::addAddressLabel(QString label, QString address) {
-    Q_ASSERT(Settings::isValidAddress(address));
+void AddressBook::appendToJournal(JournalOp op, const QString& label, const QString& address, 
+                                  const QString& newLabel) {
+    QFile journal(journalFile());
+    if (journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        QDataStream out(&journal);
+        out << (quint8)op << label << address << newLabel;
+        journal.close();
+    }
+
+    if (++journalRecords > maxJournalRecords)
+        writeToStorage();
+}
+
+void AddressBook::applyJournalOp(JournalOp op, const QString& label, const QString& address, 
+                                 const QString& newLabel) {
+    switch (op) {
+    case JournalAdd: {
+        // Labels are unique, so this replaces the label if it's already there
+        auto existing = addressByLabel.constFind(label);
+        if (existing != addressByLabel.constEnd())
+            applyJournalOp(JournalRemove, label, existing.value(), QString());
+
+        allLabels.push_back(QPair<QString, QString>(label, address));
+        indexLabel(label, address);
+        break;
+    }
+    case JournalRemove:
+        for (int i = 0; i < allLabels.size(); i++) {
+            if (allLabels[i].first == label && allLabels[i].second == address) {
+                allLabels.removeAt(i);
+                unindexLabel(label, address);
+                break;
+            }
+        }
+        break;
+    case JournalRename:
+        for (int i = 0; i < allLabels.size(); i++) {
+            if (allLabels[i].first == label && allLabels[i].second == address) {
+                allLabels[i].first = newLabel;
+                unindexLabel(label, address);
+                indexLabel(newLabel, address);
+                break;
+            }
+        }
+        break;
+    }
+}
+
+void AddressBook::rebuildIndexes() {
+    addressByLabel.clear();
+    labelByAddress.clear();
+
+    // Sort all the completions once, instead of inserting them one by one
+    QList<QPair<QString, QString>> completions;
+    for (const auto& i : allLabels) {
+        addressByLabel.insert(i.first, i.second);
+        if (!labelByAddress.contains(i.second))
+            labelByAddress.insert(i.second, i.first);
 
-    // First, remove any existing label
-    // Iterate over the list and remove the label/address
-    for (int i=0; i < allLabels.size(); i++) {
-        if (allLabels[i].first == label) {
-            removeAddressLabel(allLabels[i].first, allLabels[i].second);
+        auto text = i.first % "/" % i.second;
+        for (const auto& key : completionKeysFor(i.first, i.second)) {
+            completions.append(QPair<QString, QString>(key, text));
         }
     }
+    std::sort(completions.begin(), completions.end());
+
+    completionKeys.clear();
+    completionTexts.clear();
+    QList<QStandardItem*> items;
+    items.reserve(completions.size());
+    for (const auto& c : completions) {
+        auto item = new QStandardItem(c.second);
+        item->setData(c.first,  CompletionKeyRole);
+        item->setData(c.second, CompletionTextRole);
+        items.append(item);
+
+        completionKeys.append(c.first);
+        completionTexts.append(c.second);
+    }
 
-    allLabels.push_back(QPair<QString, QString>(label, address));
-    writeToStorage();
+    // Set all the rows in one go, so the views see one insert instead of one per row
+    completionModel->clear();
+    if (!items.isEmpty())
+        completionModel->appendColumn(items);
 }
 
-// Remove a new address/label from the database
-void AddressBook::removeAddressLabel(QString label, QString address) {
-    // Iterate over the list and remove the label/address
-    for (int i=0; i < allLabels.size(); i++) {
-        if (allLabels[i].first == label && allLabels[i].second == address) {
-            allLabels.removeAt(i);
-            writeToStorage();
-            return;
+bool AddressBook::hasCompletionsFor(const QString& prefix) const {
+    auto key = prefix.toLower();
+    auto it  = std::lower_bound(completionKeys.begin(), completionKeys.end(), key);
+    return it != completionKeys.end() && it->startsWith(key);
+}
+
+void AddressBook::indexLabel(const QString& label, const QString& address) {
+    addressByLabel.insert(label, address);
+    if (!labelByAddress.contains(address))
+        labelByAddress.insert(address, label);
+
+    addCompletions(label, address);
+}
+
+// Call after the label has been removed from (or renamed in) allLabels
+void AddressBook::unindexLabel(const QString& label, const QString& address) {
+    if (addressByLabel.value(label) == address)
+        addressByLabel.remove(label);
+
+    // If this was the address's first label, the next one (if any) takes over
+    if (labelByAddress.value(address) == label) {
+        labelByAddress.remove(address);
+        for (const auto& i : allLabels) {
+            if (i.second == address) {
+                labelByAddress.insert(address, i.first);
+                break;
+            }
         }
     }
+
+    removeCompletions(label, address);
 }
 
-void AddressBook::updateLabel(QString oldlabel, QString address, QString newlabel) {
-    // Iterate over the list and update the label/address
-    for (int i = 0; i < allLabels.size(); i++) {
-        if (allLabels[i].first == oldlabel && allLabels[i].second == address) {
-            allLabels[i].first = newlabel;
-            writeToStorage();
-            return;
+QStringList AddressBook::completionKeysFor(const QString& label, const QString& address) {
+    QStringList keys;
+    auto suffix = QString("/") % address.toLower();
+
+    // The whole label, and then from every later word in it
+    keys.append(label.toLower() % suffix);
+    for (int i = 1; i < label.length(); i++) {
+        if (label[i].isLetterOrNumber() && !label[i-1].isLetterOrNumber())
+            keys.append(label.mid(i).toLower() % suffix);
+    }
+
+    // And the address on its own
+    keys.append(address.toLower());
+
+    keys.removeDuplicates();
+    return keys;
+}
+
+void AddressBook::addCompletions(const QString& label, const QString& address) {
+    auto text = label % "/" % address;
+    for (const auto& key : completionKeysFor(label, address)) {
+        int row = std::lower_bound(completionKeys.begin(), completionKeys.end(), key) - completionKeys.begin();
+
+        auto item = new QStandardItem(text);
+        item->setData(key,  CompletionKeyRole);
+        item->setData(text, CompletionTextRole);
+        completionModel->insertRow(row, item);
+
+        completionKeys.insert(row, key);
+        completionTexts.insert(row, text);
+    }
+}
+
+void AddressBook::removeCompletions(const QString& label, const QString& address) {
+    auto text = label % "/" % address;
+    for (const auto& key : completionKeysFor(label, address)) {
+        int row = std::lower_bound(completionKeys.begin(), completionKeys.end(), key) - completionKeys.begin();
+        for (; row < completionKeys.size() && completionKeys[row] == key; row++) {
+            if (completionTexts[row] == text) {
+                completionModel->removeRow(row);
+                completionKeys.removeAt(row);
+                completionTexts.removeAt(row);
+                break;
+            }
         }
     }
 }
 
+
+// Add a new address/label to the database
+void AddressBook::addAddressLabel(QString label, QString address) {
+    Q_ASSERT(Settings::isValidAddress(address));
+
+    applyJournalOp(JournalAdd, label, address, QString());
+    appendToJournal(JournalAdd, label, address);
+}
+
+// Remove a new address/label from the database
+void AddressBook::removeAddressLabel(QString label, QString address) {
+    if (addressByLabel.value(label) != address)
+        return;
+
+    applyJournalOp(JournalRemove, label, address, QString());
+    appendToJournal(JournalRemove, label, address);
+}
+
+void AddressBook::updateLabel(QString oldlabel, QString address, QString newlabel) {
+    if (addressByLabel.value(oldlabel) != address)
+        return;
+
+    applyJournalOp(JournalRename, oldlabel, address, newlabel);
+    appendToJournal(JournalRename, oldlabel, address, newlabel);
+}
+
 // Read all addresses
 const QList<QPair<QString, QString>>& AddressBook::getAllAddressLabels() {
     if (allLabels.isEmpty()) {
@@ -354,22 +602,12 @@ const QList<QPair<QString, QString>>& AddressBook::getAllAddressLabels() {
 
 // Get the label for an address
 QString AddressBook::getLabelForAddress(QString addr) {
-    for (auto i : allLabels) {
-        if (i.second == addr)
-            return i.first;
-    }
-
-    return "";
+    return labelByAddress.value(addr);
 }
 
 // Get the address for a label
 QString AddressBook::getAddressForLabel(QString label) {
-    for (auto i: allLabels) {
-        if (i.first == label)
-            return i.second;
-    }
-
-    return "";
+    return addressByLabel.value(label);
 }
 
 QString AddressBook::addLabelToAddress(QString addr) {
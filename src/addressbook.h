@@ -29,8 +29,52 @@ private:
     QStringList headers;    
 };
 
+/**
+ * Fuzzy fallback for the label completer. With a pattern set, it keeps the entries whose 
+ * label/address contains the pattern's characters in order. With no pattern, it keeps every row.
+ */
+class LabelCompletionFilter : public QSortFilterProxyModel {
+public:
+    LabelCompletionFilter(QObject* parent) : QSortFilterProxyModel(parent) {}
+
+    void setPattern(const QString& newPattern);
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const;
+
+private:
+    QString pattern;
+};
+
+/**
+ * Completes "label/address" in the address fields. The model rows are keyed by the lower case
+ * label/address, and again from each later word of the label and from the address, so typing 
+ * any of those finds the entry. The keys are sorted, so QCompleter can binary search them.
+ * When nothing starts with the typed text, it falls back to fuzzy matching the label/address.
+ */
+class LabelCompleter : public QCompleter {
+public:
+    LabelCompleter(QAbstractItemModel* model, QObject* parent);
+
+    // Fill in the whole label/address, not the key that matched
+    QString pathFromIndex(const QModelIndex& index) const;
+
+    // Picks between the prefix search and the fuzzy filter for the typed text
+    QStringList splitPath(const QString& path) const;
+
+private:
+    LabelCompletionFilter* filter = nullptr;
+};
+
 class AddressBook {
 public:    
+    // Roles of the completion model
+    enum CompletionRole {
+        CompletionKeyRole  = Qt::UserRole + 1,     // The lower case text that's matched
+        CompletionTextRole                          // The label/address that's filled in
+    };
+
+
     // Method that opens the AddressBook dialog window. 
     static void open(MainWindow* parent, QLineEdit* target = nullptr);
 
@@ -54,6 +98,12 @@ public:
     QString getLabelForAddress(QString address);
     // Get a Label's address
     QString getAddressForLabel(QString label);
+
+    // The completions for the address fields. It's updated as labels are added and removed.
+    QAbstractItemModel* getCompletionModel() { return completionModel; }
+
+    // If any completion key starts with the (case insensitive) prefix
+    bool hasCompletionsFor(const QString& prefix) const;
 private:
     AddressBook();
 
@@ -63,6 +113,39 @@ private:
     QString writeableFile();
     QList<QPair<QString, QString>> allLabels;
 
+    // Changes are appended to the journal instead of writing the whole file every time. The 
+    // journal is folded back into the file when it gets too long.
+    enum JournalOp : quint8 {
+        JournalAdd = 1,
+        JournalRemove,
+        JournalRename
+    };
+
+    QString journalFile();
+    void    appendToJournal(JournalOp op, const QString& label, const QString& address, 
+                            const QString& newLabel = QString());
+    void    applyJournalOp(JournalOp op, const QString& label, const QString& address, 
+                           const QString& newLabel);
+    int     journalRecords              = 0;
+    static const int maxJournalRecords  = 1000;
+
+    // Both ways lookups. Labels are unique, and an address maps to its first label.
+    void    rebuildIndexes();
+    void    indexLabel(const QString& label, const QString& address);
+    void    unindexLabel(const QString& label, const QString& address);
+
+    QHash<QString, QString>         addressByLabel;
+    QHash<QString, QString>         labelByAddress;
+
+    // The completion model, and its keys and texts in the same (sorted) order
+    static QStringList completionKeysFor(const QString& label, const QString& address);
+    void    addCompletions(const QString& label, const QString& address);
+    void    removeCompletions(const QString& label, const QString& address);
+
+    QStandardItemModel*             completionModel     = nullptr;
+    QStringList                     completionKeys;
+    QStringList                     completionTexts;
+
     static AddressBook* instance;
 };
 
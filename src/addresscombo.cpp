@@ -24,15 +24,15 @@ void AddressCombo::setCurrentText(const QString& text) {
     }
 } 
 
-void AddressCombo::addItem(const QString& text, double bal) {
+void AddressCombo::addItem(const QString& text, CAmount bal) {
     QString txt = AddressBook::addLabelToAddress(text);
-    if (bal > 0)
+    if (bal > CAmount())
         txt = txt % "(" % Settings::getDisplayFormat(bal) % ")";
         
     QComboBox::addItem(txt);
 }
 
-void AddressCombo::insertItem(int index, const QString& text, double bal) {
+void AddressCombo::insertItem(int index, const QString& text, CAmount bal) {
     QString txt = AddressBook::addLabelToAddress(text) % 
                     "(" % Settings::getDisplayFormat(bal) % ")";
     QComboBox::insertItem(index, txt);
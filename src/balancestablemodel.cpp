@@ -7,25 +7,30 @@ BalancesTableModel::BalancesTableModel(QObject *parent)
     : QAbstractTableModel(parent) {    
 }
 
-void BalancesTableModel::setNewData(const QMap<QString, double>* balances, 
-    const QList<UnspentOutput>* outputs)
+void BalancesTableModel::setNewData(std::shared_ptr<const WalletSnapshot> newSnapshot)
 {    
     loading = false;
 
     int currentRows = rowCount(QModelIndex());
-    // Copy over the utxos for our use
-    delete utxos;
-    utxos = new QList<UnspentOutput>();
-    // This is a QList deep copy.
-    *utxos = *outputs;
 
-    // Process the address balances into a list
+    // Hold on to the snapshot instead of copying the utxos
+    snapshot = newSnapshot;
+
+    unconfirmedAddrs.clear();
+    for (const auto& utxo : snapshot->utxos) {
+        if (utxo.confirmations == 0)
+            unconfirmedAddrs.insert(utxo.address);
+    }
+
+    // Process the address balances into a list. Until safecoind answers, show the saved ones.
+    const auto& balances = snapshot->stale ? snapshot->cachedBalances : snapshot->balances;
+
     delete modeldata;
-    modeldata = new QList<std::tuple<QString, double>>();
-    std::for_each(balances->keyBegin(), balances->keyEnd(), [=] (auto keyIt) {
-        if (balances->value(keyIt) > 0)
-            modeldata->push_back(std::make_tuple(keyIt, balances->value(keyIt)));
-    });
+    modeldata = new QList<std::tuple<QString, CAmount>>();
+    for (auto it = balances.constBegin(); it != balances.constEnd(); it++) {
+        if (it.value() > CAmount())
+            modeldata->push_back(std::make_tuple(it.key(), it.value()));
+    }
 
     // And then update the data
     dataChanged(index(0, 0), index(modeldata->size()-1, columnCount(index(0,0))-1));
@@ -37,7 +42,6 @@ void BalancesTableModel::setNewData(const QMap<QString, double>* balances,
 
 BalancesTableModel::~BalancesTableModel() {
     delete modeldata;
-    delete utxos;
 }
 
 int BalancesTableModel::rowCount(const QModelIndex&) const
@@ -70,12 +74,10 @@ QVariant BalancesTableModel::data(const QModelIndex &index, int role) const
     if (role == Qt::ForegroundRole) {
         // If any of the UTXOs for this address has zero confirmations, paint it in red
         const auto& addr = std::get<0>(modeldata->at(index.row()));
-        for (auto utxo : *utxos) {
-            if (utxo.address == addr && utxo.confirmations == 0) {
-                QBrush b;
-                b.setColor(Qt::red);
-                return b;
-            }
+        if (unconfirmedAddrs.contains(addr)) {
+            QBrush b;
+            b.setColor(Qt::red);
+            return b;
         }
 
         // Else, just return the default brush
@@ -2,14 +2,7 @@
 #define BALANCESTABLEMODEL_H
 
 #include "precompiled.h"
-
-struct UnspentOutput {
-    QString address;
-    QString txid;
-    QString amount;    
-    int     confirmations;
-    bool    spendable;
-};
+#include "walletsnapshot.h"
 
 class BalancesTableModel : public QAbstractTableModel
 {
@@ -17,7 +10,7 @@ public:
     BalancesTableModel(QObject* parent);
     ~BalancesTableModel();
 
-    void setNewData(const QMap<QString, double>* balances, const QList<UnspentOutput>* outputs);
+    void setNewData(std::shared_ptr<const WalletSnapshot> newSnapshot);
 
     int rowCount(const QModelIndex &parent) const;
     int columnCount(const QModelIndex &parent) const;
@@ -25,8 +18,11 @@ public:
     QVariant headerData(int section, Qt::Orientation orientation, int role) const;
 
 private:
-    QList<std::tuple<QString, double>>*    modeldata   = nullptr;    
-    QList<UnspentOutput>*                  utxos       = nullptr;  
+    QList<std::tuple<QString, CAmount>>*   modeldata   = nullptr;    
+    std::shared_ptr<const WalletSnapshot>  snapshot;
+
+    // Addresses that have a UTXO with no confirmations
+    QSet<QString>                          unconfirmedAddrs;
 
     bool loading = true;
 };
@@ -0,0 +1,110 @@
+#include "camount.h"
+
+CAmount CAmount::fromDecimalString(const QString& s, bool* ok) {
+    if (ok) *ok = false;
+
+    QString str = s.trimmed();
+    int i = 0;
+    bool negative = false;
+    if (i < str.length() && (str[i] == '-' || str[i] == '+')) {
+        negative = str[i] == '-';
+        i++;
+    }
+
+    qint64 whole    = 0;
+    qint64 frac     = 0;
+    int    decimals = 0;
+    bool   digits   = false;
+    bool   point    = false;
+
+    for (; i < str.length(); i++) {
+        QChar c = str[i];
+        if (c == '.' && !point) {
+            point = true;
+        } else if (c.isDigit() && c.unicode() < 128) {
+            digits = true;
+            int d  = c.unicode() - '0';
+            if (point) {
+                if (++decimals > 8)
+                    return CAmount();
+                frac = frac * 10 + d;
+            } else {
+                // Larger than any possible amount. Checked before multiplying, so it can't overflow.
+                if (whole > (std::numeric_limits<qint64>::max() / COIN - d) / 10)
+                    return CAmount();
+                whole = whole * 10 + d;
+            }
+        } else {
+            return CAmount();
+        }
+    }
+
+    if (!digits)
+        return CAmount();
+
+    for (; decimals < 8; decimals++) {
+        frac *= 10;
+    }
+
+    // whole is at most max / COIN, so whole * COIN fits, but the decimals may still not
+    if (frac > std::numeric_limits<qint64>::max() - whole * COIN)
+        return CAmount();
+
+    if (ok) *ok = true;
+
+    qint64 zats = whole * COIN + frac;
+    return CAmount(negative ? -zats : zats);
+}
+
+CAmount CAmount::fromJson(const QJsonValue& v) {
+    if (v.isString()) {
+        bool ok;
+        auto amt = fromDecimalString(v.toString(), &ok);
+        return ok ? amt : fromDouble(v.toString().toDouble());
+    }
+
+    return fromDouble(v.toDouble());
+}
+
+int CAmount::toDecimalChars(char* buf) const {
+    // Build it backwards, then flip it
+    char tmp[maxDecimalLength];
+    int  n = 0;
+
+    quint64 abs = amount < 0 ? (quint64)(-(amount + 1)) + 1 : (quint64) amount;
+    quint64 whole = abs / COIN;
+    quint64 frac  = abs % COIN;
+
+    // Decimals, skipping the trailing zeros
+    int decimals = 8;
+    while (decimals > 0 && frac % 10 == 0) {
+        frac /= 10;
+        decimals--;
+    }
+    for (int d = 0; d < decimals; d++) {
+        tmp[n++] = '0' + (frac % 10);
+        frac /= 10;
+    }
+    if (decimals > 0)
+        tmp[n++] = '.';
+
+    do {
+        tmp[n++] = '0' + (whole % 10);
+        whole /= 10;
+    } while (whole > 0);
+
+    if (amount < 0)
+        tmp[n++] = '-';
+
+    for (int i = 0; i < n; i++) {
+        buf[i] = tmp[n - 1 - i];
+    }
+
+    return n;
+}
+
+QString CAmount::toDecimalString() const {
+    char buf[maxDecimalLength];
+    int  len = toDecimalChars(buf);
+    return QString::fromLatin1(buf, len);
+}
@@ -0,0 +1,60 @@
+#ifndef CAMOUNT_H
+#define CAMOUNT_H
+
+#include "precompiled.h"
+
+/**
+ * A SAFE amount, held as a whole number of zatoshis (1e-8 SAFE), so that amounts add up 
+ * exactly and can be formatted and parsed without going through a double.
+ */
+class CAmount {
+public:
+    static const qint64 COIN = 100000000;
+
+    CAmount() : amount(0) {}
+
+    static CAmount fromqint64(qint64 zats)  { return CAmount(zats); }
+    static CAmount fromDouble(double amt)   { return CAmount(qRound64(amt * COIN)); }
+
+    // Parse an amount like "12.345", exactly. Anything with more than 8 decimals, or that 
+    // isn't a number, sets ok to false and returns 0.
+    static CAmount fromDecimalString(const QString& s, bool* ok = nullptr);
+
+    // Amounts in RPC replies are JSON numbers, but safecoind also returns some as strings
+    static CAmount fromJson(const QJsonValue& v);
+
+    qint64  toqint64() const                { return amount; }
+    double  toDecimalDouble() const         { return (double) amount / COIN; }
+
+    // The amount as a JSON number, for RPC params that safecoind reads with get_real(), like
+    // the z_sendmany fee. A double holds every amount up to the max supply exactly.
+    QJsonValue toJsonNumber() const         { return QJsonValue(toDecimalDouble()); }
+
+    // The decimal amount, without trailing zeros, like "12.345"
+    QString toDecimalString() const;
+
+    // Write the decimal amount into buf, which has to hold at least maxDecimalLength chars. 
+    // Returns the number of chars written. Doesn't allocate.
+    static const int maxDecimalLength = 24;
+    int     toDecimalChars(char* buf) const;
+
+    CAmount operator+ (const CAmount& o) const  { return CAmount(amount + o.amount); }
+    CAmount operator- (const CAmount& o) const  { return CAmount(amount - o.amount); }
+    CAmount operator- () const                  { return CAmount(-amount); }
+    CAmount& operator+= (const CAmount& o)      { amount += o.amount; return *this; }
+    CAmount& operator-= (const CAmount& o)      { amount -= o.amount; return *this; }
+
+    bool operator< (const CAmount& o) const     { return amount <  o.amount; }
+    bool operator> (const CAmount& o) const     { return amount >  o.amount; }
+    bool operator<=(const CAmount& o) const     { return amount <= o.amount; }
+    bool operator>=(const CAmount& o) const     { return amount >= o.amount; }
+    bool operator==(const CAmount& o) const     { return amount == o.amount; }
+    bool operator!=(const CAmount& o) const     { return amount != o.amount; }
+
+private:
+    explicit CAmount(qint64 zats) : amount(zats) {}
+
+    qint64 amount;
+};
+
+#endif // CAMOUNT_H
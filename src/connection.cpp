@@ -8,6 +8,7 @@
 #include "ui_connection.h"
 #include "ui_createzcashconfdialog.h"
 #include "rpc.h"
+#include "trace.h"
 
 #include "precompiled.h"
 
@@ -31,7 +32,7 @@ ConnectionLoader::ConnectionLoader(MainWindow* main, RPC* rpc) {
         connD->topIcon->setMovie(movie1);
         movie1->start();
     }
-    main->logger->write("set animation");
+    main->logger->write(Logger::Debug, "set animation");
 }
 
 ConnectionLoader::~ConnectionLoader() {    
@@ -79,13 +80,13 @@ void ConnectionLoader::doAutoConnect(bool tryEzcashdStart) {
                             // Something is wrong. 
                             // We're going to attempt to connect to the one in the background one last time
                             // and see if that works, else throw an error
-                            main->logger->write("Unknown problem while trying to start safecoind");
+                            main->logger->write(Logger::Error, "Unknown problem while trying to start safecoind");
                             QTimer::singleShot(2000, [=]() { doAutoConnect(/* don't attempt to start ezcashd */ false); });
                         }
                     }
                 } else {
                     // We tried to start ezcashd previously, and it didn't work. So, show the error. 
-                    main->logger->write("Couldn't start embedded safecoind for unknown reason");
+                    main->logger->write(Logger::Error, "Couldn't start embedded safecoind for unknown reason");
                     QString explanation;
                     if (config->zcashDaemon) {
                         explanation = QString() % QObject::tr("You have safecoind set to start as a daemon, which can cause problems "
@@ -193,7 +194,7 @@ void ConnectionLoader::createZcashConf() {
 
     QFile file(confLocation);
     if (!file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
-        main->logger->write("Could not create safecoin.conf, returning");
+        main->logger->write(Logger::Error, "Could not create safecoin.conf, returning");
         QString explanation = QString() % QObject::tr("Could not create safecoin.conf.");
         this->showError(explanation);
         return;
@@ -286,7 +287,7 @@ void ConnectionLoader::doNextDownload(std::function<void(void)> cb) {
     currentOutput = new QFile(QDir(paramsDir).filePath(filename + ".part"));   
 
     if (!currentOutput->open(QIODevice::WriteOnly)) {
-        main->logger->write("Couldn't open " + currentOutput->fileName() + " for writing");
+        main->logger->write(Logger::Error, "Couldn't open " + currentOutput->fileName() + " for writing");
         this->showError(QObject::tr("Couldn't download params. Please check the help site for more info."));
     }
     main->logger->write("Downloading to " + filename);
@@ -328,7 +329,7 @@ void ConnectionLoader::doNextDownload(std::function<void(void)> cb) {
         currentOutput->deleteLater();
 
         if (currentDownload->error()) {
-            main->logger->write("Downloading " + filename + " failed");
+            main->logger->write(Logger::Error, "Downloading " + filename + " failed");
             this->showError(QObject::tr("Downloading ") + filename + QObject::tr(" failed. Please check the help site for more info"));                
         } else {
             doNextDownload(cb);
@@ -377,7 +378,7 @@ bool ConnectionLoader::startEmbeddedZcashd() {
 
     if (!QFile::exists(safecoindProgram)) {
         qDebug() << "Can't find safecoind at " << safecoindProgram;
-        main->logger->write("Can't find safecoind at " + safecoindProgram);
+        main->logger->write(Logger::Error, "Can't find safecoind at " + safecoindProgram);
         return false;
     } else {
         main->logger->write("Found safecoind at " + safecoindProgram);
@@ -401,7 +402,7 @@ bool ConnectionLoader::startEmbeddedZcashd() {
     auto ptr_main(main);
     QObject::connect(ezcashd.get(), &QProcess::readyReadStandardError, [weak_obj, ptr_main]() {
         auto output = weak_obj.lock()->readAllStandardError();
-        ptr_main->logger->write("safecoind stderr:" + output);
+        ptr_main->logger->write(Logger::Warning, "safecoind stderr:" + output);
         processStdErrOutput.append(output);
     });
 
@@ -511,7 +512,7 @@ Connection* ConnectionLoader::makeConnection(std::shared_ptr<ConnectionConfig> c
 }
 
 void ConnectionLoader::refreshZcashdState(Connection* connection, std::function<void(void)> refused) {
-    main->logger->write("refreshing state");
+    main->logger->write(Logger::Debug, "refreshing state");
 
 
     QJsonObject payload = {
@@ -534,7 +535,7 @@ void ConnectionLoader::refreshZcashdState(Connection* connection, std::function<
             if (err == QNetworkReply::NetworkError::ConnectionRefusedError) {   
                 refused();
             } else if (err == QNetworkReply::NetworkError::AuthenticationRequiredError) {
-                main->logger->write("Authentication failed");
+                main->logger->write(Logger::Error, "Authentication failed");
                 QString explanation = QString() % 
                         QObject::tr("Authentication failed. The username / password you specified was "
                         "not accepted by safecoind. Try changing it in the Edit->Settings menu");
@@ -803,6 +804,7 @@ Connection::Connection(MainWindow* m, QNetworkAccessManager* c, QNetworkRequest*
     this->request     = r;
     this->config      = conf;
     this->main        = m;
+    this->batchSize   = Settings::getInstance()->getBatchRPCSize();
 }
 
 Connection::~Connection() {
@@ -810,6 +812,135 @@ Connection::~Connection() {
     delete request;
 }
 
+/**
+ * Read-only calls that are safe to share between callers. Anything that changes the wallet
+ * (z_sendmany, z_getnewaddress, imports etc...) must always be sent.
+ */
+bool Connection::canCoalesce(const QString& method) {
+    static const QSet<QString> readOnly = {
+        "getinfo", "getblockchaininfo", "getnetworkinfo", "getwalletinfo", "getchaintxstats",
+        "getnetworksolps", "getactivenodes", "getnodeinfo",
+        "listunspent", "z_listunspent", "z_gettotalbalance", "listtransactions",
+        "z_listaddresses", "getaddressesbyaccount", "z_listreceivedbyaddress",
+        "gettransaction", "getblockheader", "z_getoperationstatus"
+    };
+
+    return readOnly.contains(method);
+}
+
+/**
+ * Pick the priority class for a call based on what it's used for in the UI.
+ */
+RPCPriority Connection::priorityOf(const QString& method) {
+    static const QSet<QString> send      = { "z_sendmany", "z_getoperationstatus" };
+    static const QSet<QString> refresh   = {
+        "getinfo", "getblockchaininfo", "listunspent", "z_listunspent", "z_gettotalbalance",
+        "listtransactions", "z_listaddresses", "getaddressesbyaccount", "z_listreceivedbyaddress",
+        "gettransaction", "getblockheader", "z_getmigrationstatus"
+    };
+    static const QSet<QString> telemetry = {
+        "getnetworksolps", "getactivenodes", "getnodeinfo", "getnetworkinfo", "getwalletinfo", 
+        "getchaintxstats"
+    };
+
+    if (send.contains(method))
+        return RPCPriority::Send;
+    if (refresh.contains(method))
+        return RPCPriority::Refresh;
+    if (telemetry.contains(method))
+        return RPCPriority::Telemetry;
+
+    return RPCPriority::Interactive;
+}
+
+void Connection::setMaxConcurrency(RPCPriority priority, int max) {
+    maxActive[priority] = std::max(max, 1);
+    dispatch();
+}
+
+void Connection::enqueue(RPCPriority priority, const QByteArray& body, const RPCDone& done,
+                         const std::function<void()>& sent) {
+    // A refresh that's still queued from an earlier round is the same call, so the new caller 
+    // just shares it instead of queueing it again
+    bool shareable = priority >= RPCPriority::Refresh;
+    if (shareable && queuedBodies[priority].contains(body)) {
+        auto q = queuedBodies[priority][body];
+        q->done.append(done);
+        if (sent)
+            q->sent.append(sent);
+        return;
+    }
+
+    auto next = std::make_shared<QueuedRPC>();
+    next->body = body;
+    next->done.append(done);
+    if (sent)
+        next->sent.append(sent);
+
+    queued[priority].enqueue(next);
+    if (shareable)
+        queuedBodies[priority][body] = next;
+
+    dispatch();
+}
+
+/**
+ * Send as many queued requests as the concurrency windows allow. A class that has work queued
+ * but nothing in flight gets the next free connection first, so even when the higher classes 
+ * fill their windows, every class gets at least one connection as soon as one is free. The 
+ * rest are handed out highest priority first.
+ */
+void Connection::dispatch() {
+    if (shutdownInProgress)
+        return;
+
+    int totalActive = 0;
+    for (int p = 0; p < NumRPCPriorities; p++)
+        totalActive += active[p];
+
+    for (int p = 0; p < NumRPCPriorities && totalActive < maxTotalActive; p++) {
+        if (!queued[p].isEmpty() && active[p] == 0) {
+            post(p, queued[p].dequeue());
+            totalActive++;
+        }
+    }
+
+    for (int p = 0; p < NumRPCPriorities; p++) {
+        while (!queued[p].isEmpty() && active[p] < maxActive[p] && totalActive < maxTotalActive) {
+            post(p, queued[p].dequeue());
+            totalActive++;
+        }
+    }
+}
+
+void Connection::post(int p, std::shared_ptr<QueuedRPC> next) {
+    queuedBodies[p].remove(next->body);
+    active[p]++;
+
+    // Also let QNetworkAccessManager know, so it picks the right request when a 
+    // connection frees up.
+    QNetworkRequest req(*request);
+    if (p <= RPCPriority::Send)
+        req.setPriority(QNetworkRequest::HighPriority);
+    else if (p == RPCPriority::Telemetry)
+        req.setPriority(QNetworkRequest::LowPriority);
+
+    QNetworkReply *reply = restclient->post(req, next->body);
+    for (const auto& sent : next->sent)
+        sent();
+
+    QObject::connect(reply, &QNetworkReply::finished, [=] {
+        reply->deleteLater();
+        active[p]--;
+
+        auto body = reply->readAll();
+        for (const auto& done : next->done)
+            done(reply, body);
+
+        dispatch();
+    });
+}
+
 void Connection::doRPC(const QJsonValue& payload, const std::function<void(QJsonValue)>& cb,
                        const std::function<void(QNetworkReply*, const QJsonValue&)>& ne) {
     if (shutdownInProgress) {
@@ -817,21 +948,37 @@ void Connection::doRPC(const QJsonValue& payload, const std::function<void(QJson
         return;
     }
 
-    qDebug() << "RPC:" << payload["method"].toString() << payload;
+    QString method = payload["method"].toString();
+
+    // If the same read-only call is already in flight, just wait for its result
+    QString key;
+    if (canCoalesce(method)) {
+        key = method % ":" % QString::fromUtf8(QJsonDocument(payload["params"].toArray()).toJson(QJsonDocument::Compact));
+        if (inFlight.contains(key)) {
+            inFlight[key].append(RPCWaiter{cb, ne});
+            coalescedCallCount++;
+
+            TRACE_DEBUG(traceRpc) << "RPC:" << method << "coalesced," << coalescedCallCount << "of" 
+                     << (coalescedCallCount + rpcCallCount) << "calls saved";
+            return;
+        }
+
+        inFlight[key].append(RPCWaiter{cb, ne});
+    }
+
+    rpcCallCount++;
+    TRACE_DEBUG(traceRpc) << "RPC:" << method << payload;
 
     QJsonDocument jd_rpc_call(payload.toObject());
     QByteArray ba_rpc_call = jd_rpc_call.toJson();
 
-    QNetworkReply *reply = restclient->post(*request, ba_rpc_call);
-
-    QObject::connect(reply, &QNetworkReply::finished, [=] {
-        reply->deleteLater();
+    RPCDone done = [=] (QNetworkReply* reply, const QByteArray& body) {
         if (shutdownInProgress) {
             // Ignoring callback because shutdown in progress
             return;
         }
         
-        QJsonDocument jd_reply = QJsonDocument::fromJson(reply->readAll());
+        QJsonDocument jd_reply = QJsonDocument::fromJson(body);
         QJsonValue parsed;
 
         if (jd_reply.isObject())
@@ -839,29 +986,382 @@ void Connection::doRPC(const QJsonValue& payload, const std::function<void(QJson
         else
             parsed = jd_reply.array();
 
-        if (reply->error() != QNetworkReply::NoError) {
-            ne(reply, parsed);
-            return;
-        } 
-        
-        if (parsed.isNull()) {
-            ne(reply, "Unknown error");
+        // Everyone who was waiting on this call gets the same result
+        QList<RPCWaiter> waiters;
+        if (key.isEmpty())
+            waiters.append(RPCWaiter{cb, ne});
+        else 
+            waiters = inFlight.take(key);
+
+        for (const auto& w : waiters) {
+            if (reply->error() != QNetworkReply::NoError) {
+                w.ne(reply, parsed);
+                continue;
+            } 
+            
+            if (parsed.isNull()) {
+                w.ne(reply, "Unknown error");
+            }
+            
+            w.cb(parsed["result"]);
         }
-        
-        cb(parsed["result"]);        
+    };
+
+    // stop is sent right away, even if every slot is busy, because shutdown() is called right
+    // after it and drops everything that's still queued
+    if (method == "stop") {
+        auto next = std::make_shared<QueuedRPC>();
+        next->body = ba_rpc_call;
+        next->done.append(done);
+        post(RPCPriority::Interactive, next);
+        return;
+    }
+
+    enqueue(priorityOf(method), ba_rpc_call, done);
+}
+
+/**
+ * Call gettransaction for all the txids. Txs that are at least reorgSafetyDepth deep never 
+ * change except for the number of confirmations, so they're kept in an on-disk cache and
+ * only the new and the recent txs are sent to safecoind. The block of each cached tx is 
+ * checked against the chain once per session before the cached tx is used, so txs that were
+ * reorged out while we weren't looking are fetched again.
+ */
+void Connection::doGetTransactions(const QList<QString>& txids, 
+                                   const std::function<void(QMap<QString, QJsonValue>*)>& cb) {
+    // Like doBatchRPC, there is nothing to call back with
+    if (txids.isEmpty())
+        return;
+
+    if (!txCacheLoaded)
+        loadTxCache();
+
+    // We need the current height to derive the confirmations. Until we have it, everything
+    // goes to safecoind.
+    int tipHeight = Settings::getInstance()->getBlockNumber();
+
+    QSet<QString> unverified;
+    if (tipHeight > 0) {
+        for (const auto& txid : txids) {
+            if (txCache.contains(txid) && !verifiedBlocks.contains(txCache[txid].blockhash))
+                unverified.insert(txCache[txid].blockhash);
+        }
+    }
+
+    if (unverified.isEmpty()) {
+        fetchTransactions(txids, cb);
+        return;
+    }
+
+    getBlockHeaders(unverified.toList(), [=] (QMap<QString, QJsonValue>* headers) {
+        QSet<QString> dropped;
+        for (auto it = headers->constBegin(); it != headers->constEnd(); it++) {
+            auto header = it.value().toObject();
+            if (header.isEmpty())
+                continue;   // Couldn't check it, so it's not used this time
+
+            if (header["confirmations"].toInt() > 0) {
+                verifiedBlocks.insert(it.key());
+            } else {
+                // Not on the main chain any more
+                dropped.insert(it.key());
+            }
+        }
+        delete headers;
+
+        if (!dropped.isEmpty()) {
+            QByteArray lines;
+            for (auto it = txCache.begin(); it != txCache.end(); ) {
+                if (dropped.contains(it.value().blockhash)) {
+                    lines += QJsonDocument(QJsonObject{ {"op", "drop"}, {"txid", it.key()} })
+                                .toJson(QJsonDocument::Compact) + '\n';
+                    it = txCache.erase(it);
+                } else {
+                    it++;
+                }
+            }
+
+            TRACE_WARN(traceRpc) << "Dropping cached txs from" << dropped.size() << "blocks that were reorged out";
+            appendTxCache(lines);
+        }
+
+        fetchTransactions(txids, cb);
     });
 }
 
-void Connection::doRPCWithDefaultErrorHandling(const QJsonValue& payload, const std::function<void(QJsonValue)>& cb) {
-    doRPC(payload, cb, [=] (QNetworkReply* reply, const QJsonValue &parsed) {
-        if (!parsed.isUndefined() && !parsed["error"].toObject()["message"].isNull()) {
-            this->showTxError(parsed["error"].toObject()["message"].toString());
+// Answer the txs in verified blocks from the cache, and get the rest from safecoind
+void Connection::fetchTransactions(const QList<QString>& txids, 
+                                   const std::function<void(QMap<QString, QJsonValue>*)>& cb) {
+    int tipHeight = Settings::getInstance()->getBlockNumber();
+
+    auto cached = new QMap<QString, QJsonValue>();
+    QList<QString> misses;
+    for (const auto& txid : txids) {
+        auto c = txCache.find(txid);
+        if (tipHeight > 0 && c != txCache.end() && verifiedBlocks.contains(c->blockhash)) {
+            c->lastUsed = ++txCacheClock;
+
+            auto tx = c->tx;
+            tx["confirmations"] = std::max(tipHeight - c->height + 1, 1);
+            (*cached)[txid] = tx;
         } else {
-            this->showTxError(reply->errorString());
+            misses.push_back(txid);
+        }
+    }
+
+    if (misses.isEmpty()) {
+        // Still call back later, like doBatchRPC does
+        QTimer::singleShot(0, main, [=] () {
+            if (shutdownInProgress) {
+                delete cached;
+                return;
+            }
+
+            cb(cached);
+        });
+        return;
+    }
+
+    doBatchRPC<QString>(misses,
+        [=] (QString txid) {
+            QJsonObject payload = {
+                {"jsonrpc", "1.0"},
+                {"id", "gettx"},
+                {"method", "gettransaction"},
+                {"params", QJsonArray {txid}}
+            };
+
+            return payload;
+        },
+        [=] (QMap<QString, QJsonValue>* fetched) {
+            QMap<QString, QJsonObject> deep;
+
+            for (auto it = fetched->constBegin(); it != fetched->constEnd(); it++) {
+                auto tx = it.value().toObject();
+                if (tx["confirmations"].toInt() >= Settings::reorgSafetyDepth && 
+                        !tx["blockhash"].toString().isEmpty()) {
+                    deep[it.key()] = tx;
+                }
+
+                (*cached)[it.key()] = it.value();
+            }
+
+            delete fetched;
+            cb(cached);
+
+            if (!deep.isEmpty())
+                cacheTransactions(deep);
+        }
+    );
+}
+
+/**
+ * Add deeply confirmed txs to the cache. The confirmations in the gettransaction response 
+ * can't be turned into a height without knowing the tip it was counted from, so the height 
+ * comes from the block header instead.
+ */
+void Connection::cacheTransactions(const QMap<QString, QJsonObject>& txs) {
+    QSet<QString> blocks;
+    for (const auto& tx : txs)
+        blocks.insert(tx["blockhash"].toString());
+
+    getBlockHeaders(blocks.toList(), [=] (QMap<QString, QJsonValue>* headers) {
+        QByteArray lines;
+
+        for (auto it = txs.constBegin(); it != txs.constEnd(); it++) {
+            auto tx        = it.value();
+            auto blockhash = tx["blockhash"].toString();
+            auto header    = headers->value(blockhash).toObject();
+            if (header["confirmations"].toInt() < Settings::reorgSafetyDepth || header["height"].toInt() <= 0)
+                continue;
+
+            // The raw tx is big and not used by anyone, so don't keep it around
+            tx.remove("hex");
+            tx.remove("confirmations");
+
+            int height = header["height"].toInt();
+            txCache[it.key()] = CachedTx{ blockhash, height, tx, ++txCacheClock };
+            verifiedBlocks.insert(blockhash);
+
+            lines += QJsonDocument(QJsonObject{ 
+                        {"op",          "add"},
+                        {"txid",        it.key()},
+                        {"blockhash",   blockhash},
+                        {"height",      height},
+                        {"tx",          tx} 
+                    }).toJson(QJsonDocument::Compact) + '\n';
+        }
+        delete headers;
+
+        appendTxCache(lines);
+        evictTxCache();
+    });
+}
+
+void Connection::getBlockHeaders(const QList<QString>& blockhashes, 
+                                 const std::function<void(QMap<QString, QJsonValue>*)>& cb) {
+    doBatchRPC<QString>(blockhashes,
+        [=] (QString blockhash) {
+            QJsonObject payload = {
+                {"jsonrpc", "1.0"},
+                {"id", "getblockheader"},
+                {"method", "getblockheader"},
+                {"params", QJsonArray {blockhash}}
+            };
+
+            return payload;
+        },
+        cb
+    );
+}
+
+/**
+ * The cache is per wallet and network, since the txids of one wallet are no use to another. 
+ * The wallet is told apart by the node it's on.
+ */
+QString Connection::txCacheFile() {
+    auto wallet = QCryptographicHash::hash((config->host % ":" % config->port % ":" % config->zcashDir).toUtf8(),
+                                           QCryptographicHash::Sha256).toHex().left(16);
+    auto filename = QString("txcache-") % QString::fromLatin1(wallet) % ".log";
+
+    auto dir = QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+    if (!dir.exists())
+        QDir().mkpath(dir.absolutePath());
+
+    if (Settings::getInstance()->isTestnet()) {
+        return dir.filePath("testnet-" % filename);
+    } else {
+        return dir.filePath(filename);
+    }
+}
+
+/**
+ * Read the cache log, applying the add and drop records in order. An incomplete last line 
+ * is from a write that didn't finish, and is cut off. If the log has grown well past what's 
+ * in it, or the cache is too big, it's written out again with just the entries we keep.
+ */
+void Connection::loadTxCache() {
+    txCacheLoaded = true;
+    txCache.clear();
+    verifiedBlocks.clear();
+
+    // The cache used to be shared by all wallets
+    auto legacyFile = QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation))
+                        .filePath(Settings::getInstance()->isTestnet() ? "testnet-txcache.dat" : "txcache.dat");
+    QFile::remove(legacyFile);
+
+    int numRecords = 0;
+
+    QFile file(txCacheFile());
+    if (file.open(QIODevice::ReadWrite)) {
+        qint64 validLength = 0;
+
+        while (!file.atEnd()) {
+            auto line = file.readLine();
+
+            QJsonParseError error;
+            auto record = QJsonDocument::fromJson(line, &error).object();
+            if (error.error != QJsonParseError::NoError || !line.endsWith('\n')) {
+                if (file.atEnd())
+                    break;
+
+                validLength = file.pos();
+                continue;
+            }
+
+            validLength = file.pos();
+            numRecords++;
+
+            auto txid = record["txid"].toString();
+            if (record["op"].toString() == "add") {
+                txCache[txid] = CachedTx{ record["blockhash"].toString(), record["height"].toInt(), 
+                                          record["tx"].toObject(), 0 };
+            } else {
+                txCache.remove(txid);
+            }
         }
+
+        if (validLength < file.size())
+            file.resize(validLength);
+
+        file.close();
+    }
+
+    if (txCache.size() > maxTxCacheEntries) {
+        evictTxCache();
+    } else if (numRecords > txCache.size() + txCacheSlack) {
+        writeTxCache();
+    }
+}
+
+void Connection::appendTxCache(const QByteArray& lines) {
+    if (lines.isEmpty())
+        return;
+
+    QFile file(txCacheFile());
+    if (file.open(QIODevice::Append)) {
+        file.write(lines);
+        file.close();
+    }
+}
+
+/**
+ * Keep the cache to maxTxCacheEntries, dropping the txs that were used least recently. At 
+ * startup, nothing has been used yet, so the oldest txs go first.
+ */
+void Connection::evictTxCache() {
+    if (txCache.size() <= maxTxCacheEntries)
+        return;
+
+    QList<QPair<QPair<qint64, int>, QString>> order;     // ((lastUsed, height), txid)
+    for (auto it = txCache.constBegin(); it != txCache.constEnd(); it++)
+        order.append(qMakePair(qMakePair(it.value().lastUsed, it.value().height), it.key()));
+
+    std::sort(order.begin(), order.end());
+
+    // Make some room, so we don't rewrite the file for every new tx
+    int toRemove = txCache.size() - maxTxCacheEntries + txCacheSlack;
+    for (int i = 0; i < toRemove && i < order.size(); i++)
+        txCache.remove(order[i].second);
+
+    writeTxCache();
+}
+
+// Write the whole cache out again. Only done on startup or after evicting.
+void Connection::writeTxCache() {
+    QByteArray lines;
+    for (auto it = txCache.constBegin(); it != txCache.constEnd(); it++) {
+        lines += QJsonDocument(QJsonObject{ 
+                    {"op",          "add"},
+                    {"txid",        it.key()},
+                    {"blockhash",   it.value().blockhash},
+                    {"height",      it.value().height},
+                    {"tx",          it.value().tx} 
+                }).toJson(QJsonDocument::Compact) + '\n';
+    }
+
+    QSaveFile file(txCacheFile());
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(lines);
+        file.commit();
+    }
+}
+
+void Connection::doRPCWithDefaultErrorHandling(const QJsonValue& payload, const std::function<void(QJsonValue)>& cb) {
+    doRPC(payload, cb, [=] (QNetworkReply* reply, const QJsonValue &parsed) {
+        this->showRPCError(reply, parsed);
     });
 }
 
+// Show the error safecoind returned, or the network error if there wasn't one
+void Connection::showRPCError(QNetworkReply* reply, const QJsonValue& parsed) {
+    if (!parsed.isUndefined() && !parsed["error"].toObject()["message"].isNull()) {
+        this->showTxError(parsed["error"].toObject()["message"].toString());
+    } else {
+        this->showTxError(reply->errorString());
+    }
+}
+
 void Connection::doRPCIgnoreError(const QJsonValue& payload, const std::function<void(QJsonValue)>& cb) {
     doRPC(payload, cb, [=] (auto, auto) {
         // Ignored error handling
@@ -887,4 +1387,9 @@ void Connection::showTxError(const QString& error) {
  */ 
 void Connection::shutdown() {
     shutdownInProgress = true;
+
+    for (int p = 0; p < NumRPCPriorities; p++) {
+        queued[p].clear();
+        queuedBodies[p].clear();
+    }
 }
@@ -4,6 +4,7 @@
 #include "mainwindow.h"
 #include "ui_connection.h"
 #include "precompiled.h"
+#include "trace.h"
 
 class RPC;
 
@@ -83,6 +84,82 @@ private:
     QTime downloadTime;
 };
 
+/**
+ * Priority classes for calls to safecoind. Each class has its own concurrency window in 
+ * Connection, so a send or a user action is never stuck behind a long background refresh. 
+ */
+enum RPCPriority {
+    Interactive = 0,    // User initiated: validateaddress, z_exportkey, getnewaddress...
+    Send,               // z_sendmany and watching its operation status
+    Refresh,            // Wallet data: balances, unspent, addresses, transactions
+    Telemetry,          // Node and network stats for the safecoind/SafeNodes tabs
+    NumRPCPriorities
+};
+
+/**
+ * Tracks the replies of a single doBatchRPC call. The callback is fired exactly once, either
+ * when the last reply is recorded or when the deadline expires, in which case it gets the 
+ * partial results. The callback takes ownership of the responses map, as before. 
+ */
+template<class T>
+struct BatchState {
+    BatchState(int total, std::function<void(QMap<T, QJsonValue>*)> cb) 
+        : responses(new QMap<T, QJsonValue>()), pending(total), cb(cb) {}
+
+    ~BatchState() {
+        // Only non-null if the callback was never fired
+        delete responses;
+    }
+
+    void record(const T& item, const QJsonValue& value) {
+        if (done)
+            return;
+
+        (*responses)[item] = value;
+        if (--pending <= 0)
+            finish();
+    }
+
+    void finish() {
+        if (done)
+            return;
+
+        done = true;
+        stopDeadline();
+
+        auto r = responses;
+        responses = nullptr;
+        cb(r);
+    }
+
+    // Drop everything without calling back, eg. when shutting down
+    void discard() {
+        done = true;
+        stopDeadline();
+    }
+
+    // (Re)start the deadline when a part of the batch is actually sent, so time spent waiting
+    // in the queue doesn't count towards the timeout
+    void sent() {
+        if (deadline && !done)
+            deadline->start();
+    }
+
+    void stopDeadline() {
+        if (deadline) {
+            deadline->stop();
+            deadline->deleteLater();
+            deadline = nullptr;
+        }
+    }
+
+    QMap<T, QJsonValue>*                        responses;
+    int                                         pending;
+    bool                                        done        = false;
+    QTimer*                                     deadline    = nullptr;
+    std::function<void(QMap<T, QJsonValue>*)>   cb;
+};
+
 /**
  * Represents a connection to a zcashd. It may even start a new zcashd if needed.
  * This is also a UI class, so it may show a dialog waiting for the connection.
@@ -105,84 +182,238 @@ public:
     void doRPCIgnoreError(const QJsonValue& payload, const std::function<void(QJsonValue)>& cb) ;
 
     void showTxError(const QString& error);
+    void showRPCError(QNetworkReply* reply, const QJsonValue& parsed);
+
+    // Number of calls actually sent to safecoind by doRPC, and the number of calls that were
+    // answered by piggybacking on an identical call already in flight.
+    quint64 getRPCCallCount()       { return rpcCallCount; }
+    quint64 getCoalescedCallCount() { return coalescedCallCount; }
+
+    // Max number of calls of the given priority that can be in flight at the same time
+    void    setMaxConcurrency(RPCPriority priority, int max);
+
+    // gettransaction for all the txids, answered from the on-disk cache for txs that are 
+    // reorgSafetyDepth deep. The callback takes ownership of the map, and like doBatchRPC, 
+    // it's always called later, and never for an empty list.
+    void    doGetTransactions(const QList<QString>& txids, 
+                              const std::function<void(QMap<QString, QJsonValue>*)>& cb);
 
     // Batch method. Note: Because of the template, it has to be in the header file. 
+    // The payloads are sent as JSON-RPC batch arrays of up to batchSize calls per HTTP POST, and
+    // the replies are mapped back to their items by "id". If safecoind rejects batch arrays, we
+    // fall back to sending each call individually.
     template<class T>
     void doBatchRPC(const QList<T>& payloads,
                      std::function<QJsonValue(T)> payloadGenerator,
                      std::function<void(QMap<T, QJsonValue>*)> cb) {
-        auto responses = new QMap<T, QJsonValue>(); // zAddr -> list of responses for each call.
         int totalSize = payloads.size();
         if (totalSize == 0)
             return;
 
-        // Keep track of all pending method calls, so as to prevent 
-        // any overlapping calls
-        static QMap<QString, bool> inProgress;
+        auto state = std::make_shared<BatchState<T>>(totalSize, cb);
 
-        QString method = payloadGenerator(payloads[0])["method"].toString();
-
-        //if (inProgress.value(method, false)) {
-        //    qDebug() << "In progress batch, skipping";
-        //    return;
-        //}
+        // If some replies never arrive, return whatever we have when the deadline passes, 
+        // so the caller is always called back and the responses map is always handed off. 
+        state->deadline = new QTimer(main);
+        state->deadline->setSingleShot(true);
+        QObject::connect(state->deadline, &QTimer::timeout, [=]() {
+            if (shutdownInProgress) {
+                state->discard();
+                return;
+            }
 
-        for (auto item: payloads) {
-            QJsonValue payload = payloadGenerator(item);
-            inProgress[method] = true;
-            
-            QJsonDocument jd_rpc_call(payload.toObject());
-            QByteArray ba_rpc_call = jd_rpc_call.toJson();
+            TRACE_WARN(traceRpc) << "Batch RPC timed out with" << state->pending << "of" << totalSize << "replies missing";
+            state->finish();
+        });
+        state->deadline->setInterval(batchTimeout);
 
-            QNetworkReply *reply = restclient->post(*request, ba_rpc_call);
+        for (int start = 0; start < totalSize; start += std::max(batchSize, 1)) {
+            auto chunk = payloads.mid(start, std::max(batchSize, 1));
 
-            QObject::connect(reply, &QNetworkReply::finished, [=] {
-                reply->deleteLater();
-                if (shutdownInProgress) {
-                    // Ignoring callback because shutdown in progress
-                    return;
+            if (batchSupported && chunk.size() > 1) {
+                doBatchChunk<T>(chunk, payloadGenerator, state);
+            } else {
+                for (auto item: chunk) {
+                    doBatchItem<T>(item, payloadGenerator(item), state);
                 }
-                
-                auto all = reply->readAll();            
-                auto parsed = QJsonDocument::fromJson(all);
+            }
+        }
+    }
+
+private:
+    // Callbacks waiting on a doRPC call
+    struct RPCWaiter {
+        std::function<void(QJsonValue)>                     cb;
+        std::function<void(QNetworkReply*, const QJsonValue&)> ne;
+    };
+
+    static bool         canCoalesce(const QString& method);
+    static RPCPriority  priorityOf(const QString& method);
+
+    // Called with the reply and its body when a request has finished
+    typedef std::function<void(QNetworkReply*, const QByteArray&)> RPCDone;
+
+    // A request waiting for a free slot in its priority class. Identical read-only requests
+    // queued before it was sent share it, so there can be several callbacks.
+    struct QueuedRPC {
+        QByteArray                      body;
+        QList<RPCDone>                  done;
+        QList<std::function<void()>>    sent;
+    };
+
+    // Queue a request in its priority class, and send it when there is a free slot. sent is 
+    // called when it's posted, and done when the reply has finished. The reply is deleted 
+    // after done returns.
+    void enqueue(RPCPriority priority, const QByteArray& body, const RPCDone& done, 
+                 const std::function<void()>& sent = nullptr);
+    void dispatch();
+    void post(int priority, std::shared_ptr<QueuedRPC> next);
+
+    QQueue<std::shared_ptr<QueuedRPC>>                  queued[NumRPCPriorities];
+    // The queued Refresh and Telemetry requests by body, to find a request to share
+    QHash<QByteArray, std::shared_ptr<QueuedRPC>>       queuedBodies[NumRPCPriorities];
+    int                 active[NumRPCPriorities]        = { 0, 0, 0, 0 };
+    int                 maxActive[NumRPCPriorities]     = { 4, 2, 3, 1 };
+    // QNetworkAccessManager only opens 6 connections per host, and queues everything else 
+    // internally, so we never hand it more than that.
+    static const int    maxTotalActive                  = 6;
+
+    // A gettransaction response for a tx that's deep enough to never change, except for the
+    // confirmations, which are derived from the height.
+    struct CachedTx {
+        QString     blockhash;
+        int         height;
+        QJsonObject tx;
+        qint64      lastUsed;   // txCacheClock when it was last used, for eviction
+    };
+
+    void    fetchTransactions(const QList<QString>& txids, 
+                              const std::function<void(QMap<QString, QJsonValue>*)>& cb);
+    void    cacheTransactions(const QMap<QString, QJsonObject>& txs);
+    void    getBlockHeaders(const QList<QString>& blockhashes, 
+                            const std::function<void(QMap<QString, QJsonValue>*)>& cb);
+
+    QString txCacheFile();
+    void    loadTxCache();
+    void    appendTxCache(const QByteArray& lines);
+    void    evictTxCache();
+    void    writeTxCache();
+
+    QMap<QString, CachedTx>     txCache;        // txid -> response
+    QSet<QString>               verifiedBlocks; // Blocks of cached txs seen on the main chain this session
+    qint64                      txCacheClock    = 0;
+    bool                        txCacheLoaded   = false;
+
+    static const int            maxTxCacheEntries   = 20000;
+    // How far the log may grow past the cache before it's compacted, and how much room 
+    // eviction makes
+    static const int            txCacheSlack        = 1000;
+
+    // Read-only calls currently in flight, keyed by method and params. Identical calls made 
+    // while one is in flight are added here instead of being sent again.
+    QMap<QString, QList<RPCWaiter>> inFlight;
+
+    quint64 rpcCallCount        = 0;
+    quint64 coalescedCallCount  = 0;
+
+    // Send a chunk of calls as a single JSON-RPC batch array. The "id" of each call is replaced
+    // by its index in the chunk, so the (possibly reordered) reply array can be mapped back.
+    template<class T>
+    void doBatchChunk(const QList<T>& chunk, std::function<QJsonValue(T)> payloadGenerator,
+                      std::shared_ptr<BatchState<T>> state) {
+        QJsonArray batch;
+        for (int i = 0; i < chunk.size(); i++) {
+            auto payload = payloadGenerator(chunk[i]).toObject();
+            payload["id"] = QString::number(i);
+            batch.append(payload);
+        }
+
+        auto priority = priorityOf(batch[0].toObject()["method"].toString());
 
-                if (reply->error() != QNetworkReply::NoError) {            
-                    qDebug() << parsed.toJson();
-                    qDebug() << reply->errorString();
+        enqueue(priority, QJsonDocument(batch).toJson(QJsonDocument::Compact), [=] (QNetworkReply* reply, const QByteArray& body) {
+            if (shutdownInProgress) {
+                // Ignoring callback because shutdown in progress
+                return;
+            }
+
+            auto parsed = QJsonDocument::fromJson(body);
 
-                    (*responses)[item] = {};    // Empty object
+            if (!parsed.isArray()) {
+                // If safecoind answered at all, it didn't understand the batch array, so switch 
+                // to individual calls for this chunk and all future ones. If it didn't answer,
+                // the individual calls would fail just the same, so record empty responses.
+                if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).isValid()) {
+                    TRACE_WARN(traceRpc) << "Batch RPC not supported, falling back to individual calls:" << reply->errorString();
+                    batchSupported = false;
+
+                    for (auto item: chunk) {
+                        doBatchItem<T>(item, payloadGenerator(item), state);
+                    }
                 } else {
-                    if (parsed.isEmpty()) {
-                        (*responses)[item] = {};    // Empty object
-                    } else {
-                        (*responses)[item] = parsed["result"];
+                    TRACE_WARN(traceRpc) << "Batch RPC failed:" << reply->errorString();
+
+                    for (auto item: chunk) {
+                        state->record(item, {});    // Empty object
                     }
                 }
-            });
-        }
+                return;
+            }
+
+            QVector<bool> answered(chunk.size(), false);
+            for (const auto& r : parsed.array()) {
+                bool ok;
+                int i = r.toObject()["id"].toVariant().toString().toInt(&ok);
+                if (!ok || i < 0 || i >= chunk.size() || answered[i])
+                    continue;
+
+                answered[i] = true;
+                state->record(chunk[i], r.toObject()["result"]);
+            }
+
+            // Any call that's missing from the reply is treated as failed
+            for (int i = 0; i < chunk.size(); i++) {
+                if (!answered[i])
+                    state->record(chunk[i], {});    // Empty object
+            }
+        }, [=] () { state->sent(); });
+    }
 
-        auto waitTimer = new QTimer(main);
-        QObject::connect(waitTimer, &QTimer::timeout, [=]() {
+    // Send a single call of a batch as its own HTTP request
+    template<class T>
+    void doBatchItem(const T& item, const QJsonValue& payload, std::shared_ptr<BatchState<T>> state) {
+        QJsonDocument jd_rpc_call(payload.toObject());
+        QByteArray ba_rpc_call = jd_rpc_call.toJson();
+
+        enqueue(priorityOf(payload["method"].toString()), ba_rpc_call, [=] (QNetworkReply* reply, const QByteArray& body) {
             if (shutdownInProgress) {
-                waitTimer->stop();
-                waitTimer->deleteLater();  
+                // Ignoring callback because shutdown in progress
                 return;
             }
+            
+            auto parsed = QJsonDocument::fromJson(body);
 
-            // If all responses have arrived, return
-            if (responses->size() == totalSize) {
-                waitTimer->stop();
-                
-                cb(responses);
-                inProgress[method] = false;
+            if (reply->error() != QNetworkReply::NoError) {            
+                TRACE_DEBUG(traceRpc) << parsed.toJson();
+                TRACE_DEBUG(traceRpc) << reply->errorString();
 
-                waitTimer->deleteLater();            
+                state->record(item, {});    // Empty object
+            } else {
+                if (parsed.isEmpty()) {
+                    state->record(item, {});    // Empty object
+                } else {
+                    state->record(item, parsed["result"]);
+                }
             }
-        });
-        waitTimer->start(100);    
+        }, [=] () { state->sent(); });
     }
 
-private:
+    // Max number of calls sent in one JSON-RPC batch array
+    int  batchSize          = 250;
+    // Cleared if safecoind rejects batch arrays
+    bool batchSupported     = true;
+    // How long a batch waits for missing replies before returning partial results
+    static const int batchTimeout = 2 * 60 * 1000;     // 2 mins
+
     bool shutdownInProgress = false;    
 };
 
@@ -0,0 +1,162 @@
+#include "historycache.h"
+#include "rpc.h"
+#include "trace.h"
+
+// Bump this when the format changes, older files are then ignored
+static const int historyCacheVersion = 1;
+
+/// The network isn't known until safecoind answers, so the file to use is passed in
+QString HistoryCache::writeableFile(bool testnet) {
+    auto filename = QStringLiteral("history.dat");
+
+    auto dir = QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+    if (!dir.exists())
+        QDir().mkpath(dir.absolutePath());
+
+    if (testnet) {
+        return dir.filePath("testnet-" % filename);
+    } else {
+        return dir.filePath(filename);
+    }
+}
+
+void HistoryCache::deleteCache() {
+    QFile::remove(writeableFile(false));
+    QFile::remove(writeableFile(true));
+}
+
+static QJsonArray txsToJson(const QList<TransactionItem>& txs) {
+    QJsonArray a;
+    for (const auto& tx : txs) {
+        QJsonObject o{
+            {"type",     tx.type},
+            {"datetime", QString::number(tx.datetime)},
+            {"address",  tx.address},
+            {"txid",     tx.txid},
+            {"amount",   tx.amount.toDecimalString()},
+            {"confirmations", (qint64)tx.confirmations}
+        };
+        if (!tx.fromAddr.isEmpty())
+            o["from"] = tx.fromAddr;
+        if (!tx.memo.isEmpty())
+            o["memo"] = tx.memo;
+
+        a.append(o);
+    }
+
+    return a;
+}
+
+static QList<TransactionItem> txsFromJson(const QJsonArray& a) {
+    QList<TransactionItem> txs;
+    for (const auto& i : a) {
+        auto o = i.toObject();
+        txs.push_back(TransactionItem{ o["type"].toString(), 
+                                       o["datetime"].toString().toLongLong(),
+                                       o["address"].toString(), 
+                                       o["txid"].toString(),
+                                       CAmount::fromJson(o["amount"]),
+                                       (long)o["confirmations"].toVariant().toLongLong(),
+                                       o["from"].toString(),
+                                       o["memo"].toString() });
+    }
+
+    return txs;
+}
+
+static QJsonArray stringsToJson(const QList<QString>& strings) {
+    QJsonArray a;
+    for (const auto& s : strings) {
+        a.append(s);
+    }
+
+    return a;
+}
+
+static QList<QString> stringsFromJson(const QJsonArray& a) {
+    QList<QString> strings;
+    for (const auto& i : a) {
+        strings.push_back(i.toString());
+    }
+
+    return strings;
+}
+
+bool HistoryCache::read(CachedHistory& history) {
+    QSettings s;
+    history.testnet = s.value("history/testnet", false).toBool();
+
+    QFile file(writeableFile(history.testnet));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    auto jsonDoc = QJsonDocument::fromJson(file.readAll());
+    file.close();
+
+    auto all = jsonDoc.object();
+    if (all["version"].toInt() != historyCacheVersion) {
+        TRACE_INFO(traceStorage) << "Ignoring history cache with unknown version";
+        return false;
+    }
+
+    history.tTxs     = txsFromJson(all["ttxs"].toArray());
+    history.zSentTxs = txsFromJson(all["zsenttxs"].toArray());
+    history.zRecvTxs = txsFromJson(all["zrecvtxs"].toArray());
+
+    auto balances = all["balances"].toObject();
+    if (!balances.isEmpty()) {
+        history.balancesLoaded = true;
+        history.balTransparent = CAmount::fromJson(balances["transparent"]);
+        history.shieldedSaved  = balances.contains("private");
+        history.balShielded    = CAmount::fromJson(balances["private"]);
+        history.balTotal       = CAmount::fromJson(balances["total"]);
+
+        auto addrs = balances["addresses"].toObject();
+        for (auto it = addrs.constBegin(); it != addrs.constEnd(); it++) {
+            history.balances[it.key()] = CAmount::fromJson(it.value());
+        }
+    }
+
+    history.zaddresses = stringsFromJson(all["zaddresses"].toArray());
+    history.taddresses = stringsFromJson(all["taddresses"].toArray());
+
+    return true;
+}
+
+void HistoryCache::write(const CachedHistory& history) {
+    QJsonObject all{
+        {"version",     historyCacheVersion},
+        {"ttxs",        txsToJson(history.tTxs)},
+        {"zsenttxs",    txsToJson(history.zSentTxs)},
+        {"zrecvtxs",    txsToJson(history.zRecvTxs)},
+        {"zaddresses",  stringsToJson(history.zaddresses)},
+        {"taddresses",  stringsToJson(history.taddresses)}
+    };
+
+    if (history.balancesLoaded) {
+        QJsonObject addrs;
+        for (auto it = history.balances.constBegin(); it != history.balances.constEnd(); it++) {
+            addrs[it.key()] = it.value().toDecimalString();
+        }
+
+        QJsonObject balances{
+            {"transparent", history.balTransparent.toDecimalString()},
+            {"addresses",   addrs}
+        };
+        if (history.shieldedSaved) {
+            balances["private"] = history.balShielded.toDecimalString();
+            balances["total"]   = history.balTotal.toDecimalString();
+        }
+
+        all["balances"] = balances;
+    }
+
+    QSaveFile file(writeableFile(history.testnet));
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(all).toJson(QJsonDocument::Compact));
+        if (file.commit()) {
+            QSettings s;
+            s.setValue("history/testnet", history.testnet);
+        }
+    }
+}
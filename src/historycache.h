@@ -0,0 +1,42 @@
+#ifndef HISTORYCACHE_H
+#define HISTORYCACHE_H
+
+#include "precompiled.h"
+#include "camount.h"
+
+struct TransactionItem;
+
+// The wallet as it was last seen, so it can be shown at startup before safecoind answers
+struct CachedHistory {
+    bool                    testnet         = false;
+
+    QList<TransactionItem>  tTxs;
+    QList<TransactionItem>  zSentTxs;
+    QList<TransactionItem>  zRecvTxs;
+
+    bool                    balancesLoaded  = false;
+    CAmount                 balTransparent;
+    // The shielded and total balances, and the z-address balances, are only saved if the user 
+    // allows saving z txs
+    bool                    shieldedSaved   = false;
+    CAmount                 balShielded;
+    CAmount                 balTotal;
+    QMap<QString, CAmount>  balances;
+
+    QList<QString>          zaddresses;
+    QList<QString>          taddresses;
+};
+
+class HistoryCache {
+public:
+    // Read the history of the network the wallet was last used on, which is what it's most 
+    // likely to connect to again
+    static bool read(CachedHistory& history);
+    static void write(const CachedHistory& history);
+    static void deleteCache();
+
+private:
+    static QString writeableFile(bool testnet);
+};
+
+#endif // HISTORYCACHE_H
@@ -1,31 +1,218 @@
 #include "logger.h"
+#include "trace.h"
 
-Logger::Logger(QObject *parent, QString fileName) : QObject(parent) {
-    m_showDate = true;
+/**
+ * The background thread that owns the log file. Messages are pushed onto a lock-free stack by 
+ * any thread, and the writer swaps out the whole stack at once, so neither side ever waits for
+ * the other.
+ */
+class LogWriter : public QThread {
+public:
+    LogWriter(const QString& fileName);
+    ~LogWriter();
+
+    void push(Logger::Level level, const QString& text);
+
+protected:
+    void run();
+
+private:
+    struct Entry {
+        qint64          time;       // msecs since epoch
+        Logger::Level   level;
+        QString         text;
+        Entry*          next;
+    };
+
+    void writeEntries(Entry* entries);
+    void rotateIfNeeded();
+    bool openFile();
+
+    QString                 fileName;
+    QFile                   file;
+    QDate                   fileDate;
+
+    QAtomicPointer<Entry>   head;
+    QAtomicInt              queued;
+    QAtomicInt              dropped;
+    QAtomicInt              stopping;
+
+    // Only used to sleep between flushes, and to wake up early
+    QMutex                  wakeMutex;
+    QWaitCondition          wake;
+
+    // Write out whatever is queued this often, or straight away for errors or when the queue 
+    // is filling up
+    static const int        flushInterval   = 500;          // ms
+    static const int        wakeAtQueued    = 1000;
+
+    // Drop new messages rather than use more memory than this while the disk is stalled
+    static const int        maxQueued       = 20000;
+
+    // Rotate when the file gets this big, or when the day changes, keeping this many old files
+    static const qint64     maxFileSize     = 5 * 1024 * 1024;
+    static const int        maxOldFiles     = 5;
+};
+
+LogWriter::LogWriter(const QString& fileName) : fileName(fileName) {
+    head.store(nullptr);
+    openFile();
+}
+
+LogWriter::~LogWriter() {
+    stopping.store(1);
+    {
+        QMutexLocker locker(&wakeMutex);
+        wake.wakeOne();
+    }
+    wait();
+
+    file.close();
+}
+
+void LogWriter::push(Logger::Level level, const QString& text) {
+    if (queued.fetchAndAddRelaxed(1) >= maxQueued) {
+        queued.fetchAndAddRelaxed(-1);
+        dropped.fetchAndAddRelaxed(1);
+        return;
+    }
+
+    auto entry = new Entry{ QDateTime::currentMSecsSinceEpoch(), level, text, nullptr };
+
+    Entry* oldHead;
+    do {
+        oldHead     = head.loadAcquire();
+        entry->next = oldHead;
+    } while (!head.testAndSetRelease(oldHead, entry));
+
+    if (level == Logger::Error || queued.load() == wakeAtQueued) {
+        QMutexLocker locker(&wakeMutex);
+        wake.wakeOne();
+    }
+}
+
+void LogWriter::run() {
+    while (true) {
+        bool stop = stopping.load() != 0;
+
+        // Take everything that's queued. It's newest first, so flip it around.
+        Entry* entries  = head.fetchAndStoreAcquire(nullptr);
+        Entry* reversed = nullptr;
+        while (entries != nullptr) {
+            auto next      = entries->next;
+            entries->next  = reversed;
+            reversed       = entries;
+            entries        = next;
+        }
+
+        if (reversed != nullptr)
+            writeEntries(reversed);
+
+        if (stop)
+            break;
+
+        QMutexLocker locker(&wakeMutex);
+        if (stopping.load() == 0 && head.loadAcquire() == nullptr)
+            wake.wait(&wakeMutex, flushInterval);
+    }
+}
+
+void LogWriter::writeEntries(Entry* entries) {
+    static const char* levelNames[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
+    rotateIfNeeded();
 
+    QByteArray batch;
+    int count = 0;
+
+    int numDropped = dropped.fetchAndStoreRelaxed(0);
+    if (numDropped > 0) {
+        batch += QDateTime::currentDateTime().toString("dd.MM.yyyy hh:mm:ss ").toUtf8() + 
+                 "WARN  " + QByteArray::number(numDropped) + " log messages were dropped\n";
+    }
+
+    while (entries != nullptr) {
+        batch += QDateTime::fromMSecsSinceEpoch(entries->time).toString("dd.MM.yyyy hh:mm:ss ").toUtf8();
+        batch += QByteArray(levelNames[entries->level]).leftJustified(6);
+        batch += entries->text.toUtf8();
+        batch += '\n';
+
+        auto next = entries->next;
+        delete entries;
+        entries = next;
+        count++;
+    }
+
+    queued.fetchAndAddRelaxed(-count);
+
+    if (file.isOpen()) {
+        file.write(batch);
+        file.flush();
+    }
+}
+
+bool LogWriter::openFile() {
+    if (fileName.isEmpty())
+        return false;
+
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::Append | QIODevice::Text))
+        return false;
+
+    fileDate = QDate::currentDate();
+    return true;
+}
+
+// Move the current file to .1, .1 to .2 and so on, dropping the oldest
+void LogWriter::rotateIfNeeded() {
+    if (!file.isOpen())
+        return;
+
+    if (file.size() < maxFileSize && fileDate == QDate::currentDate())
+        return;
+
+    // Don't rotate a file that's still empty just because the day changed
+    if (file.size() == 0) {
+        fileDate = QDate::currentDate();
+        return;
+    }
+
+    file.close();
+
+    QFile::remove(fileName % "." % QString::number(maxOldFiles));
+    for (int i = maxOldFiles - 1; i >= 1; i--) {
+        QFile::rename(fileName % "." % QString::number(i), fileName % "." % QString::number(i + 1));
+    }
+    QFile::rename(fileName, fileName % ".1");
+
+    openFile();
+}
+
+Logger::Logger(QObject *parent, QString fileName) : QObject(parent) {
     if (!fileName.isEmpty()) {
-        file = new QFile;
-        file->setFileName(fileName);
-        file->open(QIODevice::Append | QIODevice::Text);
+        writer = new LogWriter(fileName);
+        writer->start(QThread::LowPriority);
     }
+
+    // Debug messages go to the file only when the logging rules ask for them, eg. "safe.log.debug=true"
+    if (traceLog().isDebugEnabled())
+        minLevel = Debug;
     
     write("=========Startup==========");
 }
 
 void Logger::write(const QString &value) {
-    if (!file)
+    write(Info, value);
+}
+
+void Logger::write(Level level, const QString &value) {
+    if (!writer || level < minLevel)
         return;
-        
-    QString text = value;
-    text = QDateTime::currentDateTime().toString("dd.MM.yyyy hh:mm:ss ") + text;
-    QTextStream out(file);
-    out.setCodec("UTF-8");
-    if (file != 0) {
-        out << text << endl;
-    }
+
+    writer->push(level, value);
 }
 
 Logger::~Logger() {
-    if (file != 0)
-        file->close();
-}
\ No newline at end of file
+    // Writes out whatever is still queued
+    delete writer;
+}
@@ -3,16 +3,37 @@
 
 #include "precompiled.h"
 
+class LogWriter;
+
+/**
+ * Writes the log file on a background thread. write() only pushes the message onto a lock-free
+ * queue, so it's cheap to call from anywhere. The writer thread takes everything queued so far, 
+ * writes it out in one go, and rotates the file when it gets too big or a new day starts. If the 
+ * disk can't keep up, new messages are dropped once too many are queued, and the number dropped
+ * is written to the log when it catches up.
+ */
 class Logger : public QObject
 {
   Q_OBJECT
 public:
+  enum Level {
+    Debug = 0,
+    Info,
+    Warning,
+    Error
+  };
+
   explicit Logger(QObject *parent, QString fileName);
   ~Logger();
 
+  void write(Level level, const QString &value);
+
+  // Messages below this level are ignored
+  void setMinLevel(Level level) { minLevel = level; }
+
 private:
-  QFile *file      = nullptr;
-  bool m_showDate;
+  LogWriter* writer   = nullptr;
+  Level      minLevel = Info;
 
 signals:
 
@@ -20,4 +41,4 @@ public slots:
   void write(const QString &value);
 };
 
-#endif // LOGGER_H
\ No newline at end of file
+#endif // LOGGER_H
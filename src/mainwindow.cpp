@@ -21,6 +21,7 @@
 #include "settings.h"
 #include "version.h"
 #include "senttxstore.h"
+#include "historycache.h"
 #include "connection.h"
 #include "requestdialog.h"
 #include "websockets.h"
@@ -333,6 +334,7 @@ void MainWindow::setupSettingsModal() {
                 "Shielded z-Address transactions are stored locally in your wallet, outside safecoind. You may delete this saved information safely any time for your privacy.\nDo you want to delete the saved shielded transactions now?",
                 QMessageBox::Yes, QMessageBox::Cancel)) {
                     SentTxStore::deleteHistory();
+                    HistoryCache::deleteCache();
                     // Reload after the clear button so existing txs disappear
                     rpc->refresh(true);
             }
@@ -1328,10 +1330,16 @@ void MainWindow::setupMarketTab() {
 }
 
 void MainWindow::setupTransactionsTab() {
+    // Search box filters the table
+    QObject::connect(ui->txSearch, &QLineEdit::textChanged, [=] (auto text) {
+        rpc->getTransactionsProxy()->setSearchText(text);
+    });
+
     // Double click opens up memo if one exists
     QObject::connect(ui->transactionsTable, &QTableView::doubleClicked, [=] (auto index) {
-        auto txModel = dynamic_cast<TxTableModel *>(ui->transactionsTable->model());
-        QString memo = txModel->getMemo(index.row());
+        auto txModel = rpc->getTransactionsModel();
+        int  row     = rpc->getTransactionsProxy()->mapToSource(index).row();
+        QString memo = txModel->getMemo(row);
 
         if (!memo.isEmpty()) {
             QMessageBox mb(QMessageBox::Information, tr("Memo"), memo, QMessageBox::Ok, this);
@@ -1351,11 +1359,13 @@ void MainWindow::setupTransactionsTab() {
 
         QMenu menu(this);
 
-        auto txModel = dynamic_cast<TxTableModel *>(ui->transactionsTable->model());
+        // The table shows the search results, so map the row back to the full history
+        auto txModel = rpc->getTransactionsModel();
+        int  row     = rpc->getTransactionsProxy()->mapToSource(index).row();
 
-        QString txid = txModel->getTxId(index.row());
-        QString memo = txModel->getMemo(index.row());
-        QString addr = txModel->getAddr(index.row());
+        QString txid = txModel->getTxId(row);
+        QString memo = txModel->getMemo(row);
+        QString addr = txModel->getAddr(row);
 
         menu.addAction(tr("Copy txid"), [=] () {
             QGuiApplication::clipboard()->setText(txid);
@@ -1518,8 +1528,8 @@ void MainWindow::setupReceiveTab() {
 
     // View all addresses goes to "View all private keys"
     QObject::connect(ui->btnViewAllAddresses, &QPushButton::clicked, [=] () {
-        // If there's no RPC, return
-        if (!getRPC())
+        // If there's no RPC, or the addresses haven't loaded yet, return
+        if (!getRPC() || !getRPC()->getAllTAddresses())
             return;
 
         QDialog d(this);
@@ -1699,7 +1709,7 @@ void MainWindow::updateTAddrCombo(bool checked) {
             // If the address is in the address book, add it. 
             if (labels.contains(taddr) && !addrs.contains(taddr)) {
                 addrs.insert(taddr);
-                ui->listReceiveAddresses->addItem(taddr, 0);
+                ui->listReceiveAddresses->addItem(taddr, CAmount());
             }
         });
 
@@ -1710,14 +1720,14 @@ void MainWindow::updateTAddrCombo(bool checked) {
             if (!addrs.contains(addr))  {
                 addrs.insert(addr);
                 // Balance is zero since it has not been previously added
-                ui->listReceiveAddresses->addItem(addr, 0);
+                ui->listReceiveAddresses->addItem(addr, CAmount());
             }
         }
 
         // 4. Add a last, disabled item if there are remaining items
         if (allTaddrs->size() > addrs.size()) {
             auto num = QString::number(allTaddrs->size() - addrs.size());
-            ui->listReceiveAddresses->addItem("-- " + num + " more --", 0);
+            ui->listReceiveAddresses->addItem("-- " + num + " more --", CAmount());
 
             QStandardItemModel* model = qobject_cast<QStandardItemModel*>(ui->listReceiveAddresses->model());
             QStandardItem* item =  model->findItems("--", Qt::MatchStartsWith)[0];
@@ -6,6 +6,7 @@
 #define MAINWINDOW_H
 
 #include "precompiled.h"
+#include "camount.h"
 
 #include "logger.h"
 #include "recurring.h"
@@ -19,7 +20,7 @@ class WormholeClient;
 // Struct used to hold destination info when sending a Tx. 
 struct ToFields {
     QString addr;
-    double  amount;
+    CAmount amount;
     QString txtMemo;
     QString encodedMemo;
 };
@@ -28,7 +29,7 @@ struct ToFields {
 struct Tx {
     QString         fromAddr;
     QList<ToFields> toAddrs;
-    double          fee;
+    CAmount         fee;
 };
 
 namespace Ui {
@@ -6,6 +6,8 @@
 #include <cstdlib>
 #include <ctime>
 #include <cmath>
+#include <limits>
+#include <algorithm>
 
 #include <QtGlobal>
 
@@ -26,6 +28,8 @@
 #include <QComboBox>
 #include <QStandardItemModel>
 #include <QStandardItem>
+#include <QSortFilterProxyModel>
+#include <QBitArray>
 #include <QScrollBar>
 #include <QPainter>
 #include <QMovie>
@@ -37,9 +41,18 @@
 #include <QPushButton>
 #include <QDateTime>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicPointer>
+#include <QtConcurrent/QtConcurrent>
 #include <QSettings>
 #include <QStyle>
 #include <QFile>
+#include <QFileSystemWatcher>
+#include <QSaveFile>
 #include <QTemporaryFile>
 #include <QErrorMessage>
 #include <QApplication>
@@ -53,6 +66,7 @@
 #include <QInputDialog>
 #include <QFileDialog>
 #include <QDebug>
+#include <QLoggingCategory>
 #include <QUrl>
 #include <QQueue>
 #include <QProcess>
@@ -3,6 +3,7 @@
 #include "mainwindow.h"
 #include "rpc.h"
 #include "settings.h"
+#include "trace.h"
 #include "ui_newrecurring.h"
 #include "ui_recurringdialog.h"
 #include "ui_recurringpayments.h"
@@ -203,11 +204,11 @@ void Recurring::updateInfoWithTx(RecurringPaymentInfo* r, Tx tx) {
     r->fromAddr = tx.fromAddr;
     if (r->currency.isEmpty() || r->currency == "USD") {
         r->currency = "USD";
-        r->amt = tx.toAddrs[0].amount * Settings::getInstance()->getZECPrice();
+        r->amt = tx.toAddrs[0].amount.toDecimalDouble() * Settings::getInstance()->getZECPrice();
     }
     else {
         r->currency = Settings::getTokenName();
-        r->amt = tx.toAddrs[0].amount;
+        r->amt = tx.toAddrs[0].amount.toDecimalDouble();
     }
 
     // Make sure that the number of payments is properly listed in the array
@@ -262,8 +263,10 @@ void Recurring::addRecurringInfo(const RecurringPaymentInfo& rpi) {
     }
     
     payments.insert(rpi.getHash(), rpi);
+    updateDueTime(rpi.getHash());
     
     writeToStorage();
+    scheduleDueTimer();
 }
 
 void Recurring::removeRecurringInfo(QString hash) {
@@ -273,10 +276,15 @@ void Recurring::removeRecurringInfo(QString hash) {
     }
     
     payments.remove(hash);
+    updateDueTime(hash);
     
     writeToStorage();
+    scheduleDueTimer();
 }
 
+QString Recurring::journalFile() {
+    return writeableFile() % ".journal";
+}
 
 void Recurring::readFromStorage() {
     QFile file(writeableFile());
@@ -291,22 +299,78 @@ void Recurring::readFromStorage() {
         auto p = RecurringPaymentInfo::fromJson(k.toObject());
         payments.insert(p.getHash(), p);
     }
+
+    // Then apply the status changes made since the file was written, in order. An incomplete 
+    // last line from a crash doesn't parse, and is skipped.
+    journalRecords = 0;
+
+    QFile journal(journalFile());
+    if (journal.open(QIODevice::ReadOnly)) {
+        while (!journal.atEnd()) {
+            auto j = QJsonDocument::fromJson(journal.readLine()).object();
+            if (j.isEmpty())
+                continue;
+
+            journalRecords++;
+
+            auto hash          = j["hash"].toString();
+            auto paymentNumber = j["paymentnumber"].toInt();
+            if (!payments.contains(hash) || paymentNumber < 0 || paymentNumber >= payments[hash].payments.size())
+                continue;
+
+            auto& item  = payments[hash].payments[paymentNumber];
+            item.date   = QDateTime::fromSecsSinceEpoch(j["date"].toString().toLongLong());
+            item.txid   = j["txid"].toString();
+            item.err    = j["err"].toString();
+            item.status = (PaymentStatus)j["status"].toInt();
+        }
+        journal.close();
+    }
+
+    if (journalRecords > maxJournalRecords)
+        writeToStorage();
+
+    rebuildDueQueue();
 }
 
 
 void Recurring::writeToStorage() {
-    QFile file(writeableFile());
-    file.open(QIODevice::ReadWrite | QIODevice::Truncate);
+    QSaveFile file(writeableFile());
+    file.open(QIODevice::WriteOnly);
 
     QJsonArray arr;
     for (auto v : payments.values()) {
         arr.append(v.toJson());
     }
 
-    QTextStream out(&file);   
-    out << QJsonDocument(arr).toJson();
+    file.write(QJsonDocument(arr).toJson());
 
-    file.close();
+    // Everything in the journal is in the file now
+    if (file.commit()) {
+        QFile::remove(journalFile());
+        journalRecords = 0;
+    }
+}
+
+void Recurring::appendToJournal(const QString& hash, const RecurringPaymentInfo::PaymentItem& item) {
+    QJsonObject j{
+        {"hash",          hash},
+        {"paymentnumber", item.paymentNumber},
+        {"date",          QString::number(item.date.toSecsSinceEpoch())},
+        {"txid",          item.txid},
+        {"err",           item.err},
+        {"status",        item.status}
+    };
+
+    QFile journal(journalFile());
+    if (journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        // Start on a new line, in case the last write didn't finish
+        journal.write("\n" + QJsonDocument(j).toJson(QJsonDocument::Compact) + "\n");
+        journal.close();
+    }
+
+    if (++journalRecords > maxJournalRecords)
+        writeToStorage();
 }
 
 /**
@@ -319,20 +383,68 @@ bool Recurring::updatePaymentItem(QString hash, int paymentNumber,
         return false;
     }
 
-    payments[hash].payments[paymentNumber].date   = QDateTime::currentDateTime();
-    payments[hash].payments[paymentNumber].txid   = txid;
-    payments[hash].payments[paymentNumber].err    = err;
-    payments[hash].payments[paymentNumber].status = status;
+    auto& item  = payments[hash].payments[paymentNumber];
+    item.date   = QDateTime::currentDateTime();
+    item.txid   = txid;
+    item.err    = err;
+    item.status = status;
 
-    // Upda teht file on disk
-    writeToStorage();
+    // Record just this change on disk
+    appendToJournal(hash, item);
 
-    // Then read it back to refresh the hashes
-    readFromStorage();
+    updateDueTime(hash);
+    scheduleDueTimer();
 
     return true;
 }
 
+// Move the recurring payment to where its next payment is in the due queue
+void Recurring::updateDueTime(const QString& hash) {
+    if (dueTimes.contains(hash))
+        dueQueue.remove(dueTimes.take(hash), hash);
+
+    if (!payments.contains(hash))
+        return;
+
+    // The payments are in date order, so the first one that hasn't started is the next one
+    for (const auto& item : payments[hash].payments) {
+        if (item.status == PaymentStatus::NOT_STARTED) {
+            auto due = item.date.toSecsSinceEpoch();
+            dueTimes.insert(hash, due);
+            dueQueue.insert(due, hash);
+            return;
+        }
+    }
+}
+
+void Recurring::rebuildDueQueue() {
+    dueTimes.clear();
+    dueQueue.clear();
+
+    for (auto it = payments.constBegin(); it != payments.constEnd(); it++) {
+        updateDueTime(it.key());
+    }
+
+    scheduleDueTimer();
+}
+
+// Wake up when the earliest payment is due. The timer only runs once processPending has been
+// called, since there's nothing it could do before that.
+void Recurring::scheduleDueTimer() {
+    if (dueTimer == nullptr)
+        return;
+
+    if (dueQueue.isEmpty()) {
+        dueTimer->stop();
+        return;
+    }
+
+    // Wake up at least every hour, so a timer that was set before a clock change isn't 
+    // too far off
+    auto wait = (dueQueue.firstKey() - QDateTime::currentSecsSinceEpoch()) * (qint64)1000;
+    dueTimer->start((int)qBound((qint64)0, wait, (qint64)60 * 60 * 1000));
+}
+
 Recurring* Recurring::getInstance() {
     if (!instance) { 
         instance = new Recurring(); 
@@ -346,24 +458,58 @@ Recurring* Recurring::getInstance() {
 Recurring* Recurring::instance = nullptr;
 
 /**
- * Main worker method that will go over all the recurring paymets and process any pending ones
+ * Main worker method that processes the recurring payments that are due. It's called on every
+ * refresh, and by the due timer when the earliest payment comes due.
  */
 void Recurring::processPending(MainWindow* main) {
+    if (dueTimer == nullptr) {
+        this->main = main;
+
+        dueTimer = new QTimer();
+        dueTimer->setSingleShot(true);
+        QObject::connect(dueTimer, &QTimer::timeout, [=] () {
+            processPending(this->main);
+        });
+    }
+
     // Refuse to run on mainnet
     if (!Settings::getInstance()->isTestnet())
         return;
 
-    if (!main->isPaymentsReady())
+    // MainWindow::balancesReady calls back in here once the balances are in. Until then, 
+    // overdue payments would make the due timer fire straight away over and over, so just 
+    // check again after the next refresh.
+    if (!main->isPaymentsReady()) {
+        dueTimer->start(Settings::updateSpeed);
         return;
+    }
+
+    // Take all the recurring payments that are due off the front of the queue. Processing them
+    // can show a dialog, which might call back in here, so they're taken off first.
+    auto now = QDateTime::currentSecsSinceEpoch();
+    QList<QString> due;
+    while (!dueQueue.isEmpty() && dueQueue.firstKey() <= now) {
+        auto hash = dueQueue.first();
+        dueQueue.remove(dueQueue.firstKey(), hash);
+        dueTimes.remove(hash);
+        due.append(hash);
+    }
+
+    // Payments that are the only one due for their recurring payment, which can be batched
+    QList<DuePayment> single;
+
+    for (const auto& hash : due) {
+        if (!payments.contains(hash))
+            continue;
+
+        auto rpi = payments[hash];
 
-    // For each recurring payment
-    for (auto rpi: payments.values()) {
         // Collect all pending payments that are past due
         QList<RecurringPaymentInfo::PaymentItem> pending;
 
         for (auto pi: rpi.payments) {
             if (pi.status == PaymentStatus::NOT_STARTED && 
-                pi.date <= QDateTime::currentDateTime()) {
+                pi.date.toSecsSinceEpoch() <= now) {
                     pending.append(pi);
                 }
         }
@@ -373,13 +519,68 @@ void Recurring::processPending(MainWindow* main) {
         // If there is only 1 pending payment, then we don't have to do anything special.
         // Just process it
         if (pending.size() == 1) {
-            executeRecurringPayment(main, rpi, { pending.first().paymentNumber });
+            single.append(DuePayment{ rpi, pending.first().paymentNumber });
         } else if (pending.size() > 1) {
             // There are multiple pending payments. Ask the user what they want to do with it
             // Options are: Pay latest one, Pay all or Pay none.
             processMultiplePending(rpi, main);
         }
+
+        // Any status changes above already moved it, but put it back if there weren't any
+        if (!dueTimes.contains(hash))
+            updateDueTime(hash);
+    }
+
+    // Every tx needs its own proof and fee, so pay the ones from the same address together 
+    // if batching is turned on
+    int batchSize = Settings::getInstance()->getRecurringBatchSize();
+    if (batchSize > 1) {
+        for (const auto& batch : makeBatches(single, batchSize)) {
+            executeRecurringBatch(main, batch);
+        }
+    } else {
+        for (const auto& p : single) {
+            executeRecurringPayment(main, p.rpi, { p.paymentNumber });
+        }
+    }
+
+    scheduleDueTimer();
+}
+
+QList<QList<Recurring::DuePayment>> Recurring::makeBatches(const QList<DuePayment>& due, int maxOutputs) {
+    QList<QList<DuePayment>> batches;
+
+    // The batches that still have room, for each from address
+    QMap<QString, QList<int>> openBatches;
+
+    for (const auto& p : due) {
+        auto& open = openBatches[p.rpi.fromAddr];
+
+        // z_sendmany doesn't allow the same address twice, so find a batch that doesn't 
+        // pay this address yet
+        int found = -1;
+        for (int i : open) {
+            bool paysAddr = std::any_of(batches[i].begin(), batches[i].end(), [&] (const DuePayment& b) {
+                return b.rpi.toAddr == p.rpi.toAddr;
+            });
+            if (!paysAddr) {
+                found = i;
+                break;
+            }
+        }
+
+        if (found < 0) {
+            found = batches.size();
+            batches.append(QList<DuePayment>());
+            open.append(found);
+        }
+
+        batches[found].append(p);
+        if (batches[found].size() >= maxOutputs)
+            open.removeOne(found);
     }
+
+    return batches;
 }
 
 /**
@@ -458,24 +659,32 @@ void Recurring::processMultiplePending(RecurringPaymentInfo rpi, MainWindow* mai
     s.setValue("recurringmultipaymentstablevgeom", ui.tblPending->horizontalHeader()->saveState()); 
 }
 
-void Recurring::executeRecurringPayment(MainWindow* main, RecurringPaymentInfo rpi, QList<int> paymentNumbers) {
+bool Recurring::getPaymentAmount(const RecurringPaymentInfo& rpi, double& amt) {
     // Amount is in USD or ZEC?
-    auto amt = rpi.amt;
+    amt = rpi.amt;
     if (rpi.currency == "USD") {
         // If there is no price, then fail the payment
-        if (Settings::getInstance()->getZECPrice() == 0) {
-            for (auto paymentNumber: paymentNumbers) {
-                updatePaymentItem(rpi.getHash(), paymentNumber, 
-                    "", QObject::tr("No ZEC price was available to convert from USD"),
-                    PaymentStatus::ERROR);
-            }
-            return;
-        }
+        if (Settings::getInstance()->getZECPrice() == 0)
+            return false;
         
         // Translate it into ZEC
         amt = rpi.amt / Settings::getInstance()->getZECPrice();
     }
 
+    return true;
+}
+
+void Recurring::executeRecurringPayment(MainWindow* main, RecurringPaymentInfo rpi, QList<int> paymentNumbers) {
+    double amt;
+    if (!getPaymentAmount(rpi, amt)) {
+        for (auto paymentNumber: paymentNumbers) {
+            updatePaymentItem(rpi.getHash(), paymentNumber, 
+                "", QObject::tr("No ZEC price was available to convert from USD"),
+                PaymentStatus::ERROR);
+        }
+        return;
+    }
+
     // Build a Tx
     Tx tx;
     tx.fromAddr = rpi.fromAddr;
@@ -485,7 +694,7 @@ void Recurring::executeRecurringPayment(MainWindow* main, RecurringPaymentInfo r
     if (paymentNumbers.size() > 1)
         amt *= paymentNumbers.size();
 
-    tx.toAddrs.append(ToFields { rpi.toAddr, amt, rpi.memo, rpi.memo.toUtf8().toHex() });
+    tx.toAddrs.append(ToFields { rpi.toAddr, CAmount::fromDouble(amt), rpi.memo, rpi.memo.toUtf8().toHex() });
 
     // To prevent some weird race conditions, we immediately mark the payment as paid.
     // If something goes wrong, we'll get the error callback below, and the status will be 
@@ -510,6 +719,52 @@ void Recurring::executeRecurringPayment(MainWindow* main, RecurringPaymentInfo r
     });
 }
 
+void Recurring::executeRecurringBatch(MainWindow* main, QList<DuePayment> batch) {
+    if (batch.size() == 1) {
+        executeRecurringPayment(main, batch.first().rpi, { batch.first().paymentNumber });
+        return;
+    }
+
+    Tx tx;
+    tx.fromAddr = batch.first().rpi.fromAddr;
+    tx.fee      = Settings::getMinerFee();
+
+    // One output for each payment
+    QList<DuePayment> included;
+    for (const auto& p : batch) {
+        double amt;
+        if (!getPaymentAmount(p.rpi, amt)) {
+            updatePaymentItem(p.rpi.getHash(), p.paymentNumber, 
+                "", QObject::tr("No ZEC price was available to convert from USD"),
+                PaymentStatus::ERROR);
+            continue;
+        }
+
+        tx.toAddrs.append(ToFields { p.rpi.toAddr, CAmount::fromDouble(amt), p.rpi.memo, p.rpi.memo.toUtf8().toHex() });
+        included.append(p);
+    }
+
+    if (included.isEmpty())
+        return;
+
+    // Mark them as paid straight away, like executeRecurringPayment does
+    for (const auto& p : included) {
+        updatePaymentItem(p.rpi.getHash(), p.paymentNumber, "", "", PaymentStatus::COMPLETED);
+    }
+
+    TRACE_INFO(traceRecurring) << "Paying" << included.size() << "recurring payments from" << tx.fromAddr << "in one tx";
+
+    // They all succeed or fail together, and all get the same txid
+    doSendTx(main, tx, [=] (QString txid, QString err) {
+        for (const auto& p : included) {
+            if (err.isEmpty())
+                updatePaymentItem(p.rpi.getHash(), p.paymentNumber, txid, "", PaymentStatus::COMPLETED);
+            else
+                updatePaymentItem(p.rpi.getHash(), p.paymentNumber, "", err, PaymentStatus::ERROR);
+        }
+    });
+}
+
 /**
  * Execute a send Tx
  */ 
@@ -94,14 +94,23 @@ public:
     void        writeToStorage();
     void        readFromStorage();
 
-    // Worker method that goes through all pending recurring payments to see if any 
-    // need to be processed.
+    // Worker method that processes the recurring payments that are due. Only the ones at the 
+    // front of the due queue are looked at, so it's cheap to call when nothing is due.
     void        processPending(MainWindow* main);
     // If multiple are pending, we need to ask the user
     void        processMultiplePending(RecurringPaymentInfo rpi, MainWindow* main);
     // Execute a particular payment item
     void        executeRecurringPayment(MainWindow *, RecurringPaymentInfo rpi, QList<int> paymentNumber);
 
+    // A single due payment of a recurring payment
+    struct DuePayment {
+        RecurringPaymentInfo    rpi;
+        int                     paymentNumber;
+    };
+
+    // Pay several due payments from the same address in a single tx, with one output each
+    void        executeRecurringBatch(MainWindow* main, QList<DuePayment> batch);
+
     // Execute a Tx
     void        doSendTx(MainWindow* rpc, Tx tx, std::function<void(QString, QString)> cb);
 
@@ -112,6 +121,33 @@ private:
     Recurring() = default;
     QMap<QString, RecurringPaymentInfo> payments;
 
+    // The amount of one payment in SAFE. Returns false if it's in USD and there's no price.
+    bool        getPaymentAmount(const RecurringPaymentInfo& rpi, double& amt);
+
+    // Split the due payments into batches from the same address, with at most maxOutputs 
+    // payments each, and no address paid twice in the same batch
+    static QList<QList<DuePayment>> makeBatches(const QList<DuePayment>& due, int maxOutputs);
+
+    // Status changes are appended to the journal instead of rewriting the whole file. The 
+    // journal is folded back into the file when it gets too long.
+    QString     journalFile();
+    void        appendToJournal(const QString& hash, const RecurringPaymentInfo::PaymentItem& item);
+    int         journalRecords              = 0;
+    static const int maxJournalRecords      = 1000;
+
+    // When the next payment of each recurring payment is due (secs since epoch), by hash, 
+    // and the same ordered by due time
+    void        updateDueTime(const QString& hash);
+    void        rebuildDueQueue();
+    void        scheduleDueTimer();
+
+    QHash<QString, qint64>      dueTimes;
+    QMultiMap<qint64, QString>  dueQueue;
+
+    // Wakes up processPending when the earliest payment is due
+    QTimer*     dueTimer                    = nullptr;
+    MainWindow* main                        = nullptr;
+
     static Recurring* instance;
 };
 
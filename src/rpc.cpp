@@ -5,8 +5,10 @@
 #include "rpc.h"
 
 #include "addressbook.h"
+#include "historycache.h"
 #include "settings.h"
 #include "senttxstore.h"
+#include "trace.h"
 #include "version.h"
 #include "websockets.h"
 
@@ -27,7 +29,8 @@ RPC::RPC(MainWindow* main) {
 
     // Setup transactions table model
     transactionsTableModel = new TxTableModel(ui->transactionsTable);
-    main->ui->transactionsTable->setModel(transactionsTableModel);
+    transactionsProxyModel = new TxFilterProxyModel(transactionsTableModel, ui->transactionsTable);
+    main->ui->transactionsTable->setModel(transactionsProxyModel);
     
     // Set up timer to refresh Price
     priceTimer = new QTimer(main);
@@ -43,32 +46,90 @@ RPC::RPC(MainWindow* main) {
     });
     timer->start(Settings::updateSpeed);    
 
+    // Refresh once safecoind has stopped logging new blocks or wallet txs for a moment, so 
+    // that a burst of log lines only causes a single refresh
+    notifyTimer = new QTimer(main);
+    notifyTimer->setSingleShot(true);
+    QObject::connect(notifyTimer, &QTimer::timeout, [=]() {
+        refresh(notifyForce);
+        notifyForce = false;
+    });
+
     // Set up the timer to watch for tx status
     txTimer = new QTimer(main);
     QObject::connect(txTimer, &QTimer::timeout, [=]() {
-        watchTxStatus();
+        // Nothing to poll for if we're not waiting on any operations. addNewTxToWatch()
+        // calls watchTxStatus() directly when a new one starts.
+        if (!watchingOps.isEmpty())
+            watchTxStatus();
     });
     // Start at every 10s. When an operation is pending, this will change to every second
     txTimer->start(Settings::updateSpeed);  
 
+    // Refresh the safecoind and SafeNodes tabs when they become visible, since they're not 
+    // refreshed in the background.
+    QObject::connect(ui->tabWidget, &QTabWidget::currentChanged, [=] (int) {
+        if (conn == nullptr)
+            return;
+
+        if (isTabVisible(main->safecoindtab))
+            refreshNodeInfo();
+        if (isTabVisible(main->safenodestab))
+            refreshSafeNodes();
+    });
+    QObject::connect(qApp, &QGuiApplication::applicationStateChanged, [=] (Qt::ApplicationState state) {
+        if (state != Qt::ApplicationActive || conn == nullptr)
+            return;
+
+        if (isTabVisible(main->safecoindtab))
+            refreshNodeInfo();
+        if (isTabVisible(main->safenodestab))
+            refreshSafeNodes();
+    });
+
     usedAddresses = new QMap<QString, bool>();
+    snapshot      = std::make_shared<WalletSnapshot>();
+
+    // Show the wallet as it was last time straight away, and save it again as it changes
+    historySaveTimer = new QTimer(main);
+    historySaveTimer->setSingleShot(true);
+    QObject::connect(historySaveTimer, &QTimer::timeout, [=]() {
+        saveHistoryCache();
+    });
+
+    loadHistoryCache();
+
+    // Show sent txs as soon as they're saved, including by another copy of the wallet
+    SentTxStore::onChanged([=] () {
+        if (conn != nullptr)
+            refreshSentZTrans();
+    });
+
+    QObject::connect(transactionsTableModel, &QAbstractItemModel::rowsInserted, [=] () { scheduleHistorySave(); });
+    QObject::connect(transactionsTableModel, &QAbstractItemModel::rowsRemoved,  [=] () { scheduleHistorySave(); });
+    QObject::connect(transactionsTableModel, &QAbstractItemModel::dataChanged,  [=] () { scheduleHistorySave(); });
+    QObject::connect(transactionsTableModel, &QAbstractItemModel::modelReset,   [=] () { scheduleHistorySave(); });
 
     // Initialize the migration status to unavailable.
     this->migrationStatus.available = false;
 }
 
 RPC::~RPC() {
+    // Don't lose the last changes
+    if (historySaveTimer->isActive())
+        saveHistoryCache();
+
+    delete historySaveTimer;
     delete timer;
     delete txTimer;
+    delete notifyTimer;
+    delete logWatcher;
 
+    delete transactionsProxyModel;
     delete transactionsTableModel;
     delete balancesTableModel;
 
-    delete utxos;
-    delete allBalances;
     delete usedAddresses;
-    delete zaddresses;
-    delete taddresses;
 
     delete conn;
 }
@@ -88,6 +149,12 @@ void RPC::setConnection(Connection* c) {
     delete conn;
     this->conn = c;
 
+    // This might be a different wallet, so sync the transparent txs from scratch
+    tTransactions.clear();
+    tSyncBlock.clear();
+    tSyncHeight = 0;
+    tSyncInProgress = false;
+
     ui->statusBar->showMessage("Ready! Thank you for helping secure the Safecoin network by running a full node.");
 
     // See if we need to remove the reindex/rescan flags from the safecoin.conf file
@@ -95,6 +162,9 @@ void RPC::setConnection(Connection* c) {
     Settings::removeFromZcashConf(zcashConfLocation, "rescan");
     Settings::removeFromZcashConf(zcashConfLocation, "reindex");
 
+    // Refresh when new blocks arrive instead of polling, if we can
+    watchForNewBlocks();
+
     // Refresh the UI
     refreshPrice();
     checkForUpdate();
@@ -134,7 +204,8 @@ void RPC::getZAddresses(const std::function<void(QJsonValue)>& cb) {
     conn->doRPCWithDefaultErrorHandling(makePayload(method), cb);
 }
 
-void RPC::getTransparentUnspent(const std::function<void(QJsonValue)>& cb) {
+void RPC::getTransparentUnspent(const std::function<void(QJsonValue)>& cb,
+                                const std::function<void(QNetworkReply*, const QJsonValue&)>& err) {
     QJsonObject payload = {
         {"jsonrpc", "1.0"},
         {"id", "someid"},
@@ -142,10 +213,11 @@ void RPC::getTransparentUnspent(const std::function<void(QJsonValue)>& cb) {
         {"params", QJsonArray {0}}             // Get UTXOs with 0 confirmations as well.
     };
 
-    conn->doRPCWithDefaultErrorHandling(payload, cb);
+    conn->doRPC(payload, cb, err);
 }
 
-void RPC::getZUnspent(const std::function<void(QJsonValue)>& cb) {
+void RPC::getZUnspent(const std::function<void(QJsonValue)>& cb,
+                      const std::function<void(QNetworkReply*, const QJsonValue&)>& err) {
     QJsonObject payload = {
         {"jsonrpc", "1.0"},
         {"id", "someid"},
@@ -153,7 +225,7 @@ void RPC::getZUnspent(const std::function<void(QJsonValue)>& cb) {
         {"params", QJsonArray {0}}             // Get UTXOs with 0 confirmations as well.
     };
 
-    conn->doRPCWithDefaultErrorHandling(payload, cb);
+    conn->doRPC(payload, cb, err);
 }
 
 void RPC::newZaddr(const std::function<void(QJsonValue)>& cb) {
@@ -233,7 +305,8 @@ void RPC::validateAddress(QString address, const std::function<void(QJsonValue)>
     conn->doRPCWithDefaultErrorHandling(makePayload(method, address), cb);
 }
 
-void RPC::getBalance(const std::function<void(QJsonValue)>& cb) {
+void RPC::getBalance(const std::function<void(QJsonValue)>& cb,
+                     const std::function<void(QNetworkReply*, const QJsonValue&)>& err) {
     QJsonObject payload = {
         {"jsonrpc", "1.0"},
         {"id", "someid"},
@@ -241,12 +314,19 @@ void RPC::getBalance(const std::function<void(QJsonValue)>& cb) {
         {"params", QJsonArray {0}}             // Get Unconfirmed balance as well.
     };
 
-    conn->doRPCWithDefaultErrorHandling(payload, cb);
+    conn->doRPC(payload, cb, err);
 }
 
-void RPC::getTransactions(const std::function<void(QJsonValue)>& cb) {
-    QString method = "listtransactions";
-    conn->doRPCWithDefaultErrorHandling(makePayload(method), cb);
+void RPC::getTransactions(int count, int skip, const std::function<void(QJsonValue)>& cb,
+                          const std::function<void(QNetworkReply*, const QJsonValue&)>& err) {
+    QJsonObject payload = {
+        {"jsonrpc", "1.0"},
+        {"id", "someid"},
+        {"method", "listtransactions"},
+        {"params", QJsonArray {"*", count, skip}}
+    };
+
+    conn->doRPC(payload, cb, err);
 }
 
 void RPC::sendZTransaction(QJsonValue params, const std::function<void(QJsonValue)>& cb,
@@ -370,9 +450,7 @@ void RPC::fillTxJsonParams(QJsonArray& params, Tx tx) {
         // Construct the JSON params
         QJsonObject rec;
         rec["address"]      = toAddr.addr;
-        // Force it through string for rounding. Without this, decimal points beyond 8 places
-        // will appear, causing an "invalid amount" error
-        rec["amount"]       = Settings::getDecimalString(toAddr.amount); //.toDouble();
+        rec["amount"]       = toAddr.amount.toDecimalString();
         if (Settings::isZAddress(toAddr.addr) && !toAddr.encodedMemo.trimmed().isEmpty())
             rec["memo"]     = toAddr.encodedMemo;
 
@@ -386,7 +464,8 @@ void RPC::fillTxJsonParams(QJsonArray& params, Tx tx) {
     // Add fees if custom fees are allowed.
     if (Settings::getInstance()->getAllowCustomFees()) {
         params.push_back(1); // minconf
-        params.push_back(tx.fee);
+        // The fee has to be a JSON number, safecoind rejects a string here
+        params.push_back(tx.fee.toJsonNumber());
     }
 
 }
@@ -400,16 +479,25 @@ void RPC::noConnection() {
     main->statusLabel->setToolTip("");
     main->ui->statusBar->showMessage(QObject::tr("No Connection"), 1000);
 
-    // Clear balances table.
-    QMap<QString, double> emptyBalances;
-    QList<UnspentOutput>  emptyOutputs;
-    balancesTableModel->setNewData(&emptyBalances, &emptyOutputs);
+    // Clear Transactions table, unless it's still showing the saved history from the last run
+    if (!transactionsTableModel->isStale()) {
+        QList<TransactionItem> emptyTxs;
+        transactionsTableModel->addTData(emptyTxs);
+        transactionsTableModel->addZRecvData(emptyTxs);
+        transactionsTableModel->addZSentData(emptyTxs);
+    }
+
+    // Same for the balances
+    if (snapshot->stale)
+        return;
 
-    // Clear Transactions table.
-    QList<TransactionItem> emptyTxs;
-    transactionsTableModel->addTData(emptyTxs);
-    transactionsTableModel->addZRecvData(emptyTxs);
-    transactionsTableModel->addZSentData(emptyTxs);
+    // Clear balances table.
+    publishSnapshot([=] (WalletSnapshot& s) {
+        s.balances.clear();
+        s.utxos.clear();
+        s.anyUnconfirmed = false;
+    });
+    balancesTableModel->setNewData(snapshot);
 
     // Clear balances
     ui->balSheilded->setText("");
@@ -484,17 +572,7 @@ void RPC::refreshReceivedZTrans(QList<QString> zaddrs) {
             }
 
             // 2. For all txids, go and get the details of that txid.
-            conn->doBatchRPC<QString>(txids.toList(),
-                [=] (QString txid) {
-                    QJsonObject payload = {
-                        {"jsonrpc", "1.0"},
-                        {"id",  "gettx"},
-                        {"method", "gettransaction"},
-                        {"params", QJsonArray {txid}}
-                    };
-
-                    return payload;
-                },
+            conn->doGetTransactions(txids.toList(),
                 [=] (QMap<QString, QJsonValue>* txidDetails) {
                     QList<TransactionItem> txdata;
 
@@ -518,7 +596,7 @@ void RPC::refreshReceivedZTrans(QList<QString> zaddrs) {
                                 timestamp = txidInfo.toObject()["blocktime"].toInt();
                             }
                             
-                            auto amount        = i.toObject()["amount"].toDouble();
+                            auto amount        = CAmount::fromJson(i.toObject()["amount"]);
                             auto confirmations = static_cast<unsigned long>(txidInfo["confirmations"].toInt());
 
 
@@ -561,6 +639,14 @@ void RPC::getInfoThenRefresh(bool force) {
         // Testnet?
         if (!reply["testnet"].isNull()) {
             Settings::getInstance()->setTestnet(reply["testnet"].toBool());
+
+            // Watch the debug.log of the right network
+            if (reply["testnet"].toBool() != logWatcherTestnet)
+                watchForNewBlocks();
+
+            // And don't show the saved history of the other one
+            if (reply["testnet"].toBool() != historyTestnet)
+                dropHistoryCache();
         };
 
         // TODO: checkmark only when getinfo.synced == true!
@@ -588,6 +674,8 @@ void RPC::getInfoThenRefresh(bool force) {
 
 
         Settings::getInstance()->setZcashdVersion(version);
+        // Also set by getblockchaininfo, but the refreshes below need it now
+        Settings::getInstance()->setBlockNumber(curBlock);
 
         ui->notarized->setText(QString::number(notarized));
         ui->longestchain->setText(QString::number(longestchain));
@@ -610,7 +698,7 @@ void RPC::getInfoThenRefresh(bool force) {
 
             refreshBalances();        
             refreshAddresses();     // This calls refreshZSentTransactions() and refreshReceivedZTrans()
-            refreshTransactions();
+            refreshTransactions(curBlock);
 	    //            refreshMigration();     // Sapling turnstile migration status.
         }
 
@@ -623,50 +711,291 @@ void RPC::getInfoThenRefresh(bool force) {
             main->statusIcon->setPixmap(i.pixmap(16, 16));
         }
 
-        // Get network sol/s
-        QJsonObject payload = {
-            {"jsonrpc", "1.0"},
-            {"id", "someid"},
-            {"method", "getnetworksolps"}
-        };
+        // The safecoind and SafeNodes tabs only need to be refreshed if they're being looked at.
+        // Otherwise, they're refreshed when they're shown.
+        if (isTabVisible(main->safecoindtab))
+            refreshNodeInfo();
+        if (isTabVisible(main->safenodestab))
+            refreshSafeNodes();
+
+        // Call to see if the blockchain is syncing. 
+        conn->doRPCIgnoreError(makePayload("getblockchaininfo"), [=](const QJsonValue& reply) {
+            auto progress    = reply["verificationprogress"].toDouble();
+            // TODO: use getinfo.synced
+            bool isSyncing   = progress < 0.9999; // 99.99%
+            int  blockNumber = reply["blocks"].toInt();
 
+            int estimatedheight = 0;
+            if (!reply.toObject()["estimatedheight"].isUndefined()) {
+                estimatedheight = reply["estimatedheight"].toInt();
+            }
 
-        QString method = "getnetworksolps";
-        conn->doRPCIgnoreError(makePayload(method), [=](const QJsonValue& reply) {
-            qint64 solrate = reply.toInt();
+            auto s = Settings::getInstance();
+            s->setSyncing(isSyncing);
+            s->setBlockNumber(blockNumber);
+            QString ticker = s->get_currency_name();
+
+            // Update safecoind tab
+            if (isSyncing) {
+                QString txt = QString::number(blockNumber);
+                if (estimatedheight > 0) {
+                    txt = txt % " / ~" % QString::number(estimatedheight);
+                    // If estimated height is available, then use the download blocks 
+                    // as the progress instead of verification progress.
+                    progress = (double)blockNumber / (double)estimatedheight;
+                }
+                txt = txt %  " ( " % QString::number(progress * 100, 'f', 2) % "% )";
+                ui->blockheight->setText(txt);
+                ui->heightLabel->setText(QObject::tr("Downloading blocks"));
+            } else {
+                ui->blockheight->setText(QString::number(blockNumber));
+                ui->heightLabel->setText(QObject::tr("Block height"));
+            }
+
+            auto ticker_price = s->get_price(ticker);
+
+            QString extra = "";
+            if(ticker_price > 0 && ticker != "BTC") {
+                extra = QString::number( s->getBTCPrice() ) % "sat";
+            }
+            QString price = "";
+            if (ticker_price > 0) {
+                price = QString(", ") % "SAFE" % "=" % QString::number( (double)ticker_price,'f',8) % " " % ticker % " " % extra;
+            }
+
+            // Update the status bar
+            QString statusText = QString() %
+                (isSyncing ? QObject::tr("Syncing") : QObject::tr("Connected")) %
+                " (" %
+                (s->isTestnet() ? QObject::tr("testnet:") : "") %
+                QString::number(blockNumber) %
+                (isSyncing ? ("/" % QString::number(progress*100, 'f', 2) % "%") : QString()) %
+                ") " %
+                " Lag: " % QString::number(blockNumber - notarized) % price;
+            main->statusLabel->setText(statusText);
+
+
+            // Update the balances view to show a warning if the node is still syncing
+            ui->lblSyncWarning->setVisible(isSyncing);
+            ui->lblSyncWarningReceive->setVisible(isSyncing);
+
+            auto safePrice = Settings::getInstance()->getUSDFormat(1);
+            QString tooltip;
+            if (connections > 0) {
+                tooltip = QObject::tr("Connected to safecoind");
+            }
+            else {
+                tooltip = QObject::tr("safecoind has no peer connections");
+            }
+            tooltip = tooltip % "(v" % QString::number(Settings::getInstance()->getZcashdVersion()) % ")";
+
+            if (!safePrice.isEmpty()) {
+                tooltip = "1 SAFE = " % safePrice % "\n" % tooltip;
+
+            }
+            main->statusLabel->setToolTip(tooltip);
+            main->statusIcon->setToolTip(tooltip);
+        });
+
+
+    }, [=](QNetworkReply* reply, const QJsonValue&) {
+        // safecoind has probably disappeared.
+
+        this->noConnection();
+
+        // Prevent multiple dialog boxes, because these are called async
+        static bool shown = false;
+        if (!shown && prevCallSucceeded) { // show error only first time
+            shown = true;
+            QMessageBox::critical(main, QObject::tr("Connection Error"), QObject::tr("There was an error connecting to safecoind. The error was") + ": \n\n"
+                + reply->errorString(), QMessageBox::StandardButton::Ok);
+            shown = false;
+        }
+
+        prevCallSucceeded = false;
+    });
+}
+
+/**
+ * If safecoind is running on this machine, watch its debug.log for new blocks and new wallet
+ * txs, and refresh as soon as they show up. The refresh timer is then only kept as a slow
+ * fallback, except while syncing. Otherwise, just poll every updateSpeed as before.
+ */
+void RPC::watchForNewBlocks() {
+    delete logWatcher;
+    logWatcher = nullptr;
+    timer->start(Settings::updateSpeed);
+
+    // The network isn't known until the first getinfo, which calls this again if it turns out
+    // to be different
+    logWatcherTestnet = Settings::getInstance()->isTestnet();
+
+    if (conn == nullptr || conn->config->zcashDir.isEmpty())
+        return;
+
+    auto host = conn->config->host;
+    if (host != "127.0.0.1" && host != "localhost")
+        return;
+
+    QDir zcashDir(conn->config->zcashDir);
+    QString logFile = zcashDir.filePath(logWatcherTestnet ? "testnet3/debug.log" : "debug.log");
+
+    if (!QFile::exists(logFile)) {
+        main->logger->write("No safecoind debug.log found, polling for new blocks");
+        return;
+    }
+
+    // Only look at what gets logged from now on
+    debugLogOffset = QFileInfo(logFile).size();
+
+    logWatcher = new QFileSystemWatcher(main);
+    logWatcher->addPath(logFile);
+    QObject::connect(logWatcher, &QFileSystemWatcher::fileChanged, [=] (const QString& path) {
+        readDebugLog(path);
+
+        // Some platforms stop watching a file when it is replaced, so add it back
+        if (!logWatcher->files().contains(path) && QFile::exists(path))
+            logWatcher->addPath(path);
+    });
+
+    main->logger->write("Watching " + logFile + " for new blocks");
+    timer->start(Settings::slowUpdateSpeed);
+}
+
+// Read whatever was appended to debug.log since the last time, and schedule a refresh if it
+// has a new block or a new wallet tx
+void RPC::readDebugLog(const QString& path) {
+    // While syncing, safecoind logs new blocks many times a second, and refreshing for each of
+    // them is far more work than polling. So skip over them, and poll at the regular speed.
+    if (Settings::getInstance()->isSyncing()) {
+        debugLogOffset = QFileInfo(path).size();
+        if (timer->interval() != Settings::updateSpeed)
+            timer->start(Settings::updateSpeed);
+        return;
+    }
+
+    if (timer->interval() != Settings::slowUpdateSpeed)
+        timer->start(Settings::slowUpdateSpeed);
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    // The file was truncated or replaced (eg. shrinkdebugfile), so start from the top
+    if (file.size() < debugLogOffset)
+        debugLogOffset = 0;
+
+    // No need to read more than the last MB, even if we've fallen behind
+    debugLogOffset = std::max(debugLogOffset, file.size() - 1024 * 1024);
+
+    file.seek(debugLogOffset);
+    QByteArray newLines = file.readAll();
+    debugLogOffset += newLines.size();
+    file.close();
+
+    bool newBlock = newLines.contains("UpdateTip:");
+    bool walletTx = newLines.contains("AddToWallet");
+    if (!newBlock && !walletTx)
+        return;
+
+    // A new block is picked up by the regular refresh, but a new mempool tx doesn't change 
+    // the block number, so force the refresh for that.
+    notifyForce = notifyForce || walletTx;
+    notifyTimer->start(notifyDelay);
+}
+
+/**
+ * Whether the given tab is currently visible to the user, ie. it's the current tab and the
+ * window isn't minimized or hidden.
+ */
+bool RPC::isTabVisible(QWidget* tab) {
+    return tab != nullptr && ui->tabWidget->currentWidget() == tab &&
+           main->isVisible() && !main->isMinimized();
+}
+
+// Refresh the node and network stats shown on the safecoind tab
+void RPC::refreshNodeInfo() {
+    if  (conn == nullptr) 
+        return noConnection();
+
+    // Get network sol/s
+    QJsonObject payload = {
+        {"jsonrpc", "1.0"},
+        {"id", "someid"},
+        {"method", "getnetworksolps"}
+    };
+
+
+    QString method = "getnetworksolps";
+    conn->doRPCIgnoreError(makePayload(method), [=](const QJsonValue& reply) {
+        qint64 solrate = reply.toInt();
 
 		
-                ui->numconnections->setText(QString::number(connections));
-                ui->solrate->setText(QString::number(solrate) % " Sol/s");
-            });
+            ui->numconnections->setText(QString::number(Settings::getInstance()->getPeers()));
+            ui->solrate->setText(QString::number(solrate) % " Sol/s");
+        });
 
-        // Get activenodes
-        payload = {
-            {"jsonrpc", "1.0"},
-            {"id", "someid"},
-            {"method", "getactivenodes"}
-        };
-        conn->doRPCIgnoreError(payload, [=] (const QJsonValue& reply) {
-            double collateral_total;
-            int node_count          = reply["node_count"].toInt();
-            int tier_0_count        = reply["tier_0_count"].toInt();
-            int tier_1_count        = reply["tier_1_count"].toInt();
-            int tier_2_count        = reply["tier_2_count"].toInt();
-            int tier_3_count        = reply["tier_3_count"].toInt();
-            collateral_total    = reply["collateral_total"].toDouble();
-
-            ui->node_count->setText(QString::number(node_count));
+    // Get network info
+    payload = {
+        {"jsonrpc", "1.0"},
+        {"id", "someid"},
+        {"method", "getnetworkinfo"}
+    };
+
+    conn->doRPCIgnoreError(payload, [=](const QJsonValue& reply) {
+        QString clientname    = reply["subversion"].toString();
+        QString localservices = reply["localservices"].toString();
+
+
+        ui->clientname->setText(clientname);
+        ui->localservices->setText(localservices);
+    });
+
+
+    conn->doRPCIgnoreError(makePayload("getwalletinfo"), [=](const QJsonValue& reply) {
+        int  txcount = reply["txcount"].toInt();
+        ui->txcount->setText(QString::number(txcount));
+    });
+
+    //TODO: If -zindex is enabled, show stats
+    conn->doRPCIgnoreError(makePayload("getchaintxstats"), [=](const QJsonValue& reply) {
+        int  txcount = reply["txcount"].toInt();
+        ui->chaintxcount->setText(QString::number(txcount));
+    });
+}
+
+// Refresh the SafeNode stats shown on the SafeNodes tab
+void RPC::refreshSafeNodes() {
+    if  (conn == nullptr) 
+        return noConnection();
+
+    // Get activenodes
+    QJsonObject payload = {
+        {"jsonrpc", "1.0"},
+        {"id", "someid"},
+        {"method", "getactivenodes"}
+    };
+    conn->doRPCIgnoreError(payload, [=] (const QJsonValue& reply) {
+        double collateral_total;
+        int node_count          = reply["node_count"].toInt();
+        int tier_0_count        = reply["tier_0_count"].toInt();
+        int tier_1_count        = reply["tier_1_count"].toInt();
+        int tier_2_count        = reply["tier_2_count"].toInt();
+        int tier_3_count        = reply["tier_3_count"].toInt();
+        collateral_total    = reply["collateral_total"].toDouble();
+
+        ui->node_count->setText(QString::number(node_count));
 			
 		if (!getConnection()->config->addrindex.isEmpty()) {
 			
-            ui->tier_0_count->setText(QString::number(tier_0_count));
-            ui->tier_1_count->setText(QString::number(tier_1_count));
-            ui->tier_2_count->setText(QString::number(tier_2_count));
-            ui->tier_3_count->setText(QString::number(tier_3_count));
-            ui->collateral_total->setToolTip(Settings::getDisplayFormat(collateral_total));
-            ui->collateral_total->setText(Settings::getDisplayFormat(collateral_total));
-            ui->collateral_total_usd->setToolTip(Settings::getUSDFormat(collateral_total));
-            ui->collateral_total_usd->setText(Settings::getUSDFormat(collateral_total));
+        ui->tier_0_count->setText(QString::number(tier_0_count));
+        ui->tier_1_count->setText(QString::number(tier_1_count));
+        ui->tier_2_count->setText(QString::number(tier_2_count));
+        ui->tier_3_count->setText(QString::number(tier_3_count));
+        ui->collateral_total->setToolTip(Settings::getDisplayFormat(collateral_total));
+        ui->collateral_total->setText(Settings::getDisplayFormat(collateral_total));
+        ui->collateral_total_usd->setToolTip(Settings::getUSDFormat(collateral_total));
+        ui->collateral_total_usd->setText(Settings::getUSDFormat(collateral_total));
 
 		} else {
 				ui->tier_0_count->setText("addressindex not enabled");
@@ -678,16 +1007,16 @@ void RPC::getInfoThenRefresh(bool force) {
 		}
 
 
-        });
+    });
 
 
-        // Get nodeinfo
-        payload = {
-            {"jsonrpc", "1.0"},
-            {"id", "someid"},
-            {"method", "getnodeinfo"}
-        };
-        conn->doRPCIgnoreError(payload, [=] (const QJsonValue& reply) {
+    // Get nodeinfo
+    payload = {
+        {"jsonrpc", "1.0"},
+        {"id", "someid"},
+        {"method", "getnodeinfo"}
+    };
+    conn->doRPCIgnoreError(payload, [=] (const QJsonValue& reply) {
 		
 		double balance, collateral;
 		int tier;
@@ -812,188 +1141,215 @@ void RPC::getInfoThenRefresh(bool force) {
 			ui->safeheight->setText("not configured");
 			ui->safeaddress->setText("not configured");
 	}
-        });
-
-
-        // Get network info
-        payload = {
-            {"jsonrpc", "1.0"},
-            {"id", "someid"},
-            {"method", "getnetworkinfo"}
-        };
-
-        conn->doRPCIgnoreError(payload, [=](const QJsonValue& reply) {
-            QString clientname    = reply["subversion"].toString();
-            QString localservices = reply["localservices"].toString();
+    });
+}
 
+void RPC::refreshAddresses() {
+    if  (conn == nullptr) 
+        return noConnection();
+    
+    getZAddresses([=] (QJsonValue reply) {
+        QList<QString> newzaddresses;
+        for (const auto& it : reply.toArray()) {
+            auto addr = it.toString();
+            newzaddresses.push_back(addr);
+        }
 
-            ui->clientname->setText(clientname);
-            ui->localservices->setText(localservices);
+        publishSnapshot([&] (WalletSnapshot& s) {
+            s.zaddresses       = newzaddresses;
+            s.zaddressesLoaded = true;
         });
 
+        // Refresh the sent and received txs from all these z-addresses
+        refreshSentZTrans();
+        refreshReceivedZTrans(newzaddresses);
+    });
 
-        conn->doRPCIgnoreError(makePayload("getwalletinfo"), [=](const QJsonValue& reply) {
-            int  txcount = reply["txcount"].toInt();
-            ui->txcount->setText(QString::number(txcount));
-        });
+    getTAddresses([=] (QJsonValue reply) {
+        QList<QString> newtaddresses;
+        for (const auto& it : reply.toArray()) {
+            auto addr = it.toString();
+            if (Settings::isTAddress(addr))
+                newtaddresses.push_back(addr);
+        }
 
-        //TODO: If -zindex is enabled, show stats
-        conn->doRPCIgnoreError(makePayload("getchaintxstats"), [=](const QJsonValue& reply) {
-            int  txcount = reply["txcount"].toInt();
-            ui->chaintxcount->setText(QString::number(txcount));
+        publishSnapshot([&] (WalletSnapshot& s) {
+            s.taddresses       = newtaddresses;
+            s.taddressesLoaded = true;
         });
 
-        // Call to see if the blockchain is syncing. 
-        conn->doRPCIgnoreError(makePayload("getblockchaininfo"), [=](const QJsonValue& reply) {
-            auto progress    = reply["verificationprogress"].toDouble();
-            // TODO: use getinfo.synced
-            bool isSyncing   = progress < 0.9999; // 99.99%
-            int  blockNumber = reply["blocks"].toInt();
+        // If there are no t Addresses, create one
+	//        newTaddr([=] (json reply) {
+            // What if taddress gets deleted before this executes?
+        //    taddresses->append(QString::fromStdString(reply.get<json::string_t>()));
+        //});
+    });
+}
 
-            int estimatedheight = 0;
-            if (!reply.toObject()["estimatedheight"].isUndefined()) {
-                estimatedheight = reply["estimatedheight"].toInt();
-            }
+// Make the next snapshot from the current one, and swap it in
+void RPC::publishSnapshot(const std::function<void(WalletSnapshot&)>& update) {
+    auto next = std::make_shared<WalletSnapshot>(*snapshot);
+    update(*next);
+    next->version = snapshot->version + 1;
 
-            auto s = Settings::getInstance();
-            s->setSyncing(isSyncing);
-            s->setBlockNumber(blockNumber);
-            QString ticker = s->get_currency_name();
+    snapshot = next;
+    AppDataModel::getInstance()->setSnapshot(snapshot);
 
-            // Update safecoind tab
-            if (isSyncing) {
-                QString txt = QString::number(blockNumber);
-                if (estimatedheight > 0) {
-                    txt = txt % " / ~" % QString::number(estimatedheight);
-                    // If estimated height is available, then use the download blocks 
-                    // as the progress instead of verification progress.
-                    progress = (double)blockNumber / (double)estimatedheight;
-                }
-                txt = txt %  " ( " % QString::number(progress * 100, 'f', 2) % "% )";
-                ui->blockheight->setText(txt);
-                ui->heightLabel->setText(QObject::tr("Downloading blocks"));
-            } else {
-                ui->blockheight->setText(QString::number(blockNumber));
-                ui->heightLabel->setText(QObject::tr("Block height"));
-            }
+    scheduleHistorySave();
+}
 
-            auto ticker_price = s->get_price(ticker);
+void RPC::scheduleHistorySave() {
+    if (historySaveTimer != nullptr && !historySaveTimer->isActive())
+        historySaveTimer->start(historySaveDelay);
+}
 
-            QString extra = "";
-            if(ticker_price > 0 && ticker != "BTC") {
-                extra = QString::number( s->getBTCPrice() ) % "sat";
-            }
-            QString price = "";
-            if (ticker_price > 0) {
-                price = QString(", ") % "SAFE" % "=" % QString::number( (double)ticker_price,'f',8) % " " % ticker % " " % extra;
-            }
+/**
+ * Show the wallet as it was saved at the end of the last run, until safecoind answers. The 
+ * txs are greyed out, and each part is replaced as soon as it's refreshed.
+ */
+void RPC::loadHistoryCache() {
+    CachedHistory history;
+    if (!HistoryCache::read(history))
+        return;
 
-            // Update the status bar
-            QString statusText = QString() %
-                (isSyncing ? QObject::tr("Syncing") : QObject::tr("Connected")) %
-                " (" %
-                (s->isTestnet() ? QObject::tr("testnet:") : "") %
-                QString::number(blockNumber) %
-                (isSyncing ? ("/" % QString::number(progress*100, 'f', 2) % "%") : QString()) %
-                ") " %
-                " Lag: " % QString::number(blockNumber - notarized) % price;
-            main->statusLabel->setText(statusText);
+    historyTestnet = history.testnet;
+    transactionsTableModel->addCachedData(history.tTxs, history.zSentTxs, history.zRecvTxs);
+
+    // The saved balances and addresses are only for showing, so they go in the cached fields.
+    // The live ones stay empty and not loaded, so nothing (like the send tab) takes them for 
+    // the real thing.
+    publishSnapshot([&] (WalletSnapshot& s) {
+        s.stale                = history.balancesLoaded;
+        s.cachedBalTransparent = history.balTransparent;
+        s.cachedBalShielded    = history.balShielded;
+        s.cachedBalTotal       = history.balTotal;
+        s.cachedBalances       = history.balances;
+        s.cachedZaddresses     = history.zaddresses;
+        s.cachedTaddresses     = history.taddresses;
+    });
+    balancesTableModel->setNewData(snapshot);
 
+    if (history.balancesLoaded) {
+        auto tooltip = QObject::tr("Saved balance, waiting for safecoind");
 
-            // Update the balances view to show a warning if the node is still syncing
-            ui->lblSyncWarning->setVisible(isSyncing);
-            ui->lblSyncWarningReceive->setVisible(isSyncing);
+        ui->balTransparent->setText(Settings::getDisplayFormat(history.balTransparent));
+        ui->balTransparent->setToolTip(tooltip);
 
-            auto safePrice = Settings::getInstance()->getUSDFormat(1);
-            QString tooltip;
-            if (connections > 0) {
-                tooltip = QObject::tr("Connected to safecoind");
-            }
-            else {
-                tooltip = QObject::tr("safecoind has no peer connections");
-            }
-            tooltip = tooltip % "(v" % QString::number(Settings::getInstance()->getZcashdVersion()) % ")";
+        if (history.shieldedSaved) {
+            ui->balSheilded   ->setText(Settings::getDisplayFormat(history.balShielded));
+            ui->balTotal      ->setText(Settings::getDisplayFormat(history.balTotal));
 
-            if (!safePrice.isEmpty()) {
-                tooltip = "1 SAFE = " % safePrice % "\n" % tooltip;
+            ui->balSheilded   ->setToolTip(tooltip);
+            ui->balTotal      ->setToolTip(tooltip);
+        }
+    }
 
-            }
-            main->statusLabel->setToolTip(tooltip);
-            main->statusIcon->setToolTip(tooltip);
-        });
+    // Nothing new to save yet
+    savedSnapshot       = snapshot;
+    savedHistoryVersion = transactionsTableModel->getHistoryVersion();
+}
 
+// safecoind turned out to be on a different network than the saved history, so stop showing it
+void RPC::dropHistoryCache() {
+    historyTestnet = Settings::getInstance()->isTestnet();
 
-    }, [=](QNetworkReply* reply, const QJsonValue&) {
-        // safecoind has probably disappeared.
+    if (transactionsTableModel->isStale()) {
+        QList<TransactionItem> emptyTxs;
+        transactionsTableModel->addTData(emptyTxs);
+        transactionsTableModel->addZRecvData(emptyTxs);
+        transactionsTableModel->addZSentData(emptyTxs);
+    }
 
-        this->noConnection();
+    if (snapshot->stale) {
+        publishSnapshot([=] (WalletSnapshot& s) {
+            s.stale                = false;
+            s.cachedBalTransparent = CAmount();
+            s.cachedBalShielded    = CAmount();
+            s.cachedBalTotal       = CAmount();
+            s.cachedBalances.clear();
+            s.cachedZaddresses.clear();
+            s.cachedTaddresses.clear();
+        });
+        balancesTableModel->setNewData(snapshot);
 
-        // Prevent multiple dialog boxes, because these are called async
-        static bool shown = false;
-        if (!shown && prevCallSucceeded) { // show error only first time
-            shown = true;
-            QMessageBox::critical(main, QObject::tr("Connection Error"), QObject::tr("There was an error connecting to safecoind. The error was") + ": \n\n"
-                + reply->errorString(), QMessageBox::StandardButton::Ok);
-            shown = false;
-        }
+        ui->balSheilded   ->setText("");
+        ui->balTransparent->setText("");
+        ui->balTotal      ->setText("");
+    }
 
-        prevCallSucceeded = false;
-    });
+    savedSnapshot       = snapshot;
+    savedHistoryVersion = transactionsTableModel->getHistoryVersion();
 }
 
-void RPC::refreshAddresses() {
-    if  (conn == nullptr) 
-        return noConnection();
-    
-    auto newzaddresses = new QList<QString>();
-
-    getZAddresses([=] (QJsonValue reply) {
-        for (const auto& it : reply.toArray()) {
-            auto addr = it.toString();
-            newzaddresses->push_back(addr);
-        }
+void RPC::saveHistoryCache() {
+    // A new snapshot is published on every refresh, and the confirmations change with every 
+    // block, so only save when something else changed
+    bool walletChanged = savedSnapshot == nullptr ||
+                         snapshot->balancesLoaded != savedSnapshot->balancesLoaded ||
+                         snapshot->balTotal       != savedSnapshot->balTotal ||
+                         snapshot->balances       != savedSnapshot->balances ||
+                         snapshot->zaddresses     != savedSnapshot->zaddresses ||
+                         snapshot->taddresses     != savedSnapshot->taddresses;
+    if (!walletChanged && transactionsTableModel->getHistoryVersion() == savedHistoryVersion)
+        return;
 
-        delete zaddresses;
-        zaddresses = newzaddresses;
+    // Nothing has been refreshed from safecoind yet
+    if (snapshot->stale && transactionsTableModel->isStale())
+        return;
 
-        // Refresh the sent and received txs from all these z-addresses
-        refreshSentZTrans();
-        refreshReceivedZTrans(*zaddresses);
-    });
+    // The saved history of the other network is still showing
+    if (historyTestnet != Settings::getInstance()->isTestnet())
+        return;
 
-    
-    auto newtaddresses = new QList<QString>();
-    getTAddresses([=] (QJsonValue reply) {
-        for (const auto& it : reply.toArray()) {
-            auto addr = it.toString();
-            if (Settings::isTAddress(addr))
-                newtaddresses->push_back(addr);
+    CachedHistory history;
+    history.testnet = Settings::getInstance()->isTestnet();
+    history.tTxs    = transactionsTableModel->getSourceData(TxTableModel::TSource);
+
+    // Whatever hasn't been refreshed yet is saved back as it was loaded
+    bool stale             = snapshot->stale;
+    const auto& balances   = stale ? snapshot->cachedBalances : snapshot->balances;
+    const auto& zaddresses = snapshot->zaddressesLoaded ? snapshot->zaddresses : snapshot->cachedZaddresses;
+    const auto& taddresses = snapshot->taddressesLoaded ? snapshot->taddresses : snapshot->cachedTaddresses;
+
+    history.balancesLoaded = snapshot->balancesLoaded || stale;
+    history.balTransparent = stale ? snapshot->cachedBalTransparent : snapshot->balTransparent;
+    history.taddresses     = taddresses;
+
+    // Nothing shielded is kept on disk unless the user allows it
+    if (Settings::getInstance()->getSaveZtxs()) {
+        history.zSentTxs      = transactionsTableModel->getSourceData(TxTableModel::ZSentSource);
+        history.zRecvTxs      = transactionsTableModel->getSourceData(TxTableModel::ZRecvSource);
+        history.shieldedSaved = true;
+        history.balShielded   = stale ? snapshot->cachedBalShielded : snapshot->balShielded;
+        history.balTotal      = stale ? snapshot->cachedBalTotal    : snapshot->balTotal;
+        history.balances      = balances;
+        history.zaddresses    = zaddresses;
+    } else {
+        for (auto it = balances.constBegin(); it != balances.constEnd(); it++) {
+            if (Settings::isTAddress(it.key()))
+                history.balances[it.key()] = it.value();
         }
+    }
 
-        delete taddresses;
-        taddresses = newtaddresses;
+    HistoryCache::write(history);
 
-        // If there are no t Addresses, create one
-	//        newTaddr([=] (json reply) {
-            // What if taddress gets deleted before this executes?
-        //    taddresses->append(QString::fromStdString(reply.get<json::string_t>()));
-        //});
-    });
+    savedSnapshot       = snapshot;
+    savedHistoryVersion = transactionsTableModel->getHistoryVersion();
 }
 
 // Function to create the data model and update the views, used below.
-void RPC::updateUI(bool anyUnconfirmed) {    
-    ui->unconfirmedWarning->setVisible(anyUnconfirmed);
+void RPC::updateUI() {    
+    ui->unconfirmedWarning->setVisible(snapshot->anyUnconfirmed);
 
     // Update balances model data, which will update the table too
-    balancesTableModel->setNewData(allBalances, utxos);
+    balancesTableModel->setNewData(snapshot);
 
     // Update from address
     main->updateFromCombo();
 };
 
 // Function to process reply of the listunspent and z_listunspent API calls, used below.
-bool RPC::processUnspent(const QJsonValue& reply, QMap<QString, double>* balancesMap, QList<UnspentOutput>* newUtxos) {
+bool RPC::processUnspent(const QJsonValue& reply, QMap<QString, CAmount>* balancesMap, QList<UnspentOutput>* newUtxos) {
     bool anyUnconfirmed = false;
     for (const auto& it : reply.toArray()) {
         QString qsAddr = it.toObject()["address"].toString();
@@ -1002,12 +1358,12 @@ bool RPC::processUnspent(const QJsonValue& reply, QMap<QString, double>* balance
             anyUnconfirmed = true;
         }
 
+        auto amount = CAmount::fromJson(it.toObject()["amount"]);
         newUtxos->push_back(
-            UnspentOutput{ qsAddr, it.toObject()["txid"].toString(),
-                            Settings::getDecimalString(it.toObject()["amount"].toDouble()),
+            UnspentOutput{ qsAddr, it.toObject()["txid"].toString(), amount,
                             (int)confirmations, it.toObject()["spendable"].toBool() });
 
-        (*balancesMap)[qsAddr] = (*balancesMap)[qsAddr] + it.toObject()["amount"].toDouble();
+        (*balancesMap)[qsAddr] += amount;
     }
     return anyUnconfirmed;
 };
@@ -1018,90 +1374,273 @@ void RPC::refreshBalances() {
     if  (conn == nullptr) 
         return noConnection();
 
-    // 1. Get the Balances
-    getBalance([=] (QJsonValue reply) {
+    // The total balance and the t and z UTXOs are fetched in parallel, and the UI is only 
+    // updated once all 3 have answered, so it always shows a consistent snapshot. If a call 
+    // fails, whatever it would have replaced is kept from the last refresh.
+    enum BalancePart { Balance = 0, TUnspent, ZUnspent, NumBalanceParts };
+
+    struct BalanceReplies {
+        QJsonValue      values[NumBalanceParts];
+        bool            answered[NumBalanceParts]   = { false, false, false };
+        bool            failed[NumBalanceParts]     = { false, false, false };
+        int             pending                     = NumBalanceParts;
+        QElapsedTimer   elapsed;
+    };
 
-        auto balT      = reply["transparent"].toString().toDouble();
-        auto balZ      = reply["private"].toString().toDouble();
-        auto balTotal  = reply["total"].toString().toDouble();
+    auto replies = std::make_shared<BalanceReplies>();
+    replies->elapsed.start();
 
+    auto fnJoin = [=] () {
+        if (--replies->pending > 0)
+            return;
 
-        AppDataModel::getInstance()->setBalances(balT, balZ);
+        TRACE_DEBUG(traceRpc) << "Balances refreshed in" << replies->elapsed.elapsed() << "ms";
 
-        ui->balSheilded   ->setText(Settings::getDisplayFormat(balZ));
-        ui->balTransparent->setText(Settings::getDisplayFormat(balT));
-        ui->balTotal      ->setText(Settings::getDisplayFormat(balTotal));
+        bool balanceOk = !replies->failed[Balance];
+        bool unspentOk = !replies->failed[TUnspent] && !replies->failed[ZUnspent];
+        if (!balanceOk || !unspentOk) {
+            TRACE_WARN(traceRpc) << "Balance refresh failed for" 
+                                 << (balanceOk ? "" : "z_gettotalbalance") 
+                                 << (unspentOk ? "" : "listunspent/z_listunspent");
+        }
 
+        // 1. The Balances
+        auto balT      = CAmount::fromJson(replies->values[Balance]["transparent"]);
+        auto balZ      = CAmount::fromJson(replies->values[Balance]["private"]);
+        auto balTotal  = CAmount::fromJson(replies->values[Balance]["total"]);
 
-        ui->balSheilded   ->setToolTip(Settings::getDisplayFormat(balZ));
-        ui->balTransparent->setToolTip(Settings::getDisplayFormat(balT));
-        ui->balTotal      ->setToolTip(Settings::getDisplayFormat(balTotal));
+        if (balanceOk) {
+            ui->balSheilded   ->setText(Settings::getDisplayFormat(balZ));
+            ui->balTransparent->setText(Settings::getDisplayFormat(balT));
+            ui->balTotal      ->setText(Settings::getDisplayFormat(balTotal));
 
-        ui->balUSDTotal      ->setText(Settings::getUSDFormat(balTotal));
-        ui->balUSDTotal      ->setToolTip(Settings::getUSDFormat(balTotal));
-    });
 
-    // 2. Get the UTXOs
-    // First, create a new UTXO list. It will be replacing the existing list when everything is processed.
-    auto newUtxos = new QList<UnspentOutput>();
-    auto newBalances = new QMap<QString, double>();
+            ui->balSheilded   ->setToolTip(Settings::getDisplayFormat(balZ));
+            ui->balTransparent->setToolTip(Settings::getDisplayFormat(balT));
+            ui->balTotal      ->setToolTip(Settings::getDisplayFormat(balTotal));
 
-    // Call the Transparent and Z unspent APIs serially and then, once they're done, update the UI
-    getTransparentUnspent([=] (QJsonValue reply) {
-        auto anyTUnconfirmed = processUnspent(reply, newBalances, newUtxos);
+            ui->balUSDTotal      ->setText(Settings::getUSDFormat(balTotal));
+            ui->balUSDTotal      ->setToolTip(Settings::getUSDFormat(balTotal));
+        }
 
-        getZUnspent([=] (QJsonValue reply) {
-            auto anyZUnconfirmed = processUnspent(reply, newBalances, newUtxos);
+        // 2. The UTXOs. Create a new UTXO list, which replaces the existing list.
+        QList<UnspentOutput>    newUtxos;
+        QMap<QString, CAmount>  newBalances;
+        bool                    anyUnconfirmed = false;
 
-            // Swap out the balances and UTXOs
-            delete allBalances;
-            delete utxos;
+        if (unspentOk) {
+            auto anyTUnconfirmed = processUnspent(replies->values[TUnspent], &newBalances, &newUtxos);
+            auto anyZUnconfirmed = processUnspent(replies->values[ZUnspent], &newBalances, &newUtxos);
+            anyUnconfirmed = anyTUnconfirmed || anyZUnconfirmed;
+        }
 
-            allBalances = newBalances;
-            utxos       = newUtxos;
+        if (!balanceOk && !unspentOk)
+            return;
 
-            updateUI(anyTUnconfirmed || anyZUnconfirmed);
+        // Publish the balances and UTXOs in one go
+        publishSnapshot([&] (WalletSnapshot& s) {
+            if (balanceOk) {
+                s.balTransparent = balT;
+                s.balShielded    = balZ;
+                s.balTotal       = balTotal;
+            }
+
+            if (unspentOk) {
+                s.balances       = newBalances;
+                s.utxos          = newUtxos;
+                s.anyUnconfirmed = anyUnconfirmed;
+                s.balancesLoaded = true;
+            }
+            s.stale          = false;
+        });
 
+        updateUI();
+
+        // Like before, sending is possible once the UTXOs are in
+        if (unspentOk)
             main->balancesReady();
-        });        
-    });
+    };
+
+    // Each part is counted once, even if safecoind's reply reports both an error and a result
+    auto fnReply = [=] (BalancePart part, const QJsonValue& reply) {
+        if (replies->answered[part])
+            return;
+
+        replies->answered[part] = true;
+        replies->values[part]   = reply;
+        fnJoin();
+    };
+
+    auto fnError = [=] (BalancePart part, QNetworkReply* reply, const QJsonValue& parsed) {
+        if (replies->answered[part])
+            return;
+
+        replies->answered[part] = true;
+        replies->failed[part]   = true;
+        conn->showRPCError(reply, parsed);
+        fnJoin();
+    };
+
+    getBalance(
+        [=] (QJsonValue reply) { fnReply(Balance, reply); },
+        [=] (QNetworkReply* reply, const QJsonValue& parsed) { fnError(Balance, reply, parsed); });
+
+    getTransparentUnspent(
+        [=] (QJsonValue reply) { fnReply(TUnspent, reply); },
+        [=] (QNetworkReply* reply, const QJsonValue& parsed) { fnError(TUnspent, reply, parsed); });
+
+    getZUnspent(
+        [=] (QJsonValue reply) { fnReply(ZUnspent, reply); },
+        [=] (QNetworkReply* reply, const QJsonValue& parsed) { fnError(ZUnspent, reply, parsed); });
 }
 
-void RPC::refreshTransactions() {    
+/**
+ * Refresh the transparent txs. The first time, the whole history is fetched page by page. 
+ * After that, only the txs since the last synced block are fetched with listsinceblock.
+ */
+void RPC::refreshTransactions(int tipHeight) {    
     if  (conn == nullptr) 
         return noConnection();
 
-    getTransactions([=] (QJsonValue reply) {
-        QList<TransactionItem> txdata;
+    // A full sync can take several refreshes on big wallets, so don't start another one
+    if (tSyncInProgress)
+        return;
 
-        for (const auto& it : reply.toArray()) {
-            double fee = 0;
-            if (!it.toObject()["fee"].isNull()) {
-                fee = it.toObject()["fee"].toDouble();
-            }
+    if (tSyncBlock.isEmpty())
+        fetchAllTTransactions(tipHeight);
+    else
+        fetchTTransactionsSince(tipHeight);
+}
+
+void RPC::fetchAllTTransactions(int tipHeight) {
+    tSyncInProgress = true;
 
-            QString address = (it.toObject()["address"].isNull() ? "" : it.toObject()["address"].toString());
+    // Remember where the chain is before we start, so anything that comes in while we're 
+    // paging through the history is picked up by the next listsinceblock.
+    conn->doRPC(makePayload("getbestblockhash"), [=] (QJsonValue reply) {
+        fetchTTransactionsPage(0, tipHeight, reply.toString(), std::make_shared<QMap<QString, TTxEntry>>());
+    }, [=] (QNetworkReply*, const QJsonValue&) {
+        tSyncInProgress = false;
+    });
+}
 
-            TransactionItem tx{
-                it.toObject()["category"].toString(),
-                (qint64)it.toObject()["time"].toInt(),
-                address,
-                it.toObject()["txid"].toString(),
-                it.toObject()["amount"].toDouble() + fee,
-		  static_cast<long>(it.toObject()["confirmations"].toInt()),
-                "", "" };
+void RPC::fetchTTransactionsPage(int skip, int tipHeight, QString cursor,
+                                 std::shared_ptr<QMap<QString, TTxEntry>> entries) {
+    getTransactions(tTxPageSize, skip, [=] (QJsonValue reply) {
+        auto page = reply.toArray();
+        for (const auto& it : page) {
+            addTTransaction(*entries, it, tipHeight);
+        }
 
-            txdata.push_back(tx);
-            if (!address.isEmpty())
-                usedAddresses->insert(address, true);
+        if (page.size() == tTxPageSize) {
+            fetchTTransactionsPage(skip + tTxPageSize, tipHeight, cursor, entries);
+            return;
         }
 
-        // Update model data, which updates the table view
-        transactionsTableModel->addTData(txdata);        
+        // That was the last page
+        tTransactions   = *entries;
+        tSyncBlock      = cursor;
+        tSyncHeight     = tipHeight;
+        tSyncInProgress = false;
+
+        publishTTransactions(tipHeight);
+    }, [=] (QNetworkReply*, const QJsonValue&) {
+        // Try again from the top on the next refresh
+        tSyncInProgress = false;
     });
 }
 
-// Read sent Z transactions from the file.
+/**
+ * Fetch the txs since the last synced block. The synced block is always kept reorgSafetyDepth
+ * blocks behind the tip, and all the txs after it are replaced by what listsinceblock returns, 
+ * so txs from blocks that got reorged away are dropped. 
+ */
+void RPC::fetchTTransactionsSince(int tipHeight) {
+    QJsonObject payload = {
+        {"jsonrpc", "1.0"},
+        {"id", "someid"},
+        {"method", "listsinceblock"},
+        {"params", QJsonArray {tSyncBlock, Settings::reorgSafetyDepth}}
+    };
+
+    tSyncInProgress = true;
+    conn->doRPC(payload, [=] (QJsonValue reply) {
+        tSyncInProgress = false;
+
+        // Drop everything that's not yet reorgSafetyDepth deep, since listsinceblock returns 
+        // all of them again.
+        for (auto it = tTransactions.begin(); it != tTransactions.end(); ) {
+            if (it->height == 0 || it->height > tSyncHeight)
+                it = tTransactions.erase(it);
+            else
+                it++;
+        }
+
+        for (const auto& it : reply["transactions"].toArray()) {
+            addTTransaction(tTransactions, it, tipHeight);
+        }
+
+        // listsinceblock returns the block reorgSafetyDepth deep as "lastblock". Its height is 
+        // estimated from the tip, with a block of margin in case one came in meanwhile.
+        tSyncBlock  = reply["lastblock"].toString();
+        tSyncHeight = std::max(tSyncHeight, tipHeight - Settings::reorgSafetyDepth + 2);
+
+        publishTTransactions(tipHeight);
+    }, [=] (QNetworkReply*, const QJsonValue& parsed) {
+        tSyncInProgress = false;
+
+        // If safecoind doesn't know the synced block (eg. a different wallet), start over. 
+        // Otherwise it's probably a connection problem, so just try again next time.
+        if (!parsed.isNull() && parsed["error"].isObject()) {
+            TRACE_WARN(traceRpc) << "listsinceblock failed, doing a full transparent tx sync";
+            tSyncBlock.clear();
+            fetchAllTTransactions(tipHeight);
+        }
+    });
+}
+
+void RPC::addTTransaction(QMap<QString, TTxEntry>& entries, const QJsonValue& it, int tipHeight) {
+    CAmount fee;
+    if (!it.toObject()["fee"].isNull()) {
+        fee = CAmount::fromJson(it.toObject()["fee"]);
+    }
+
+    QString address = (it.toObject()["address"].isNull() ? "" : it.toObject()["address"].toString());
+    auto confirmations = it.toObject()["confirmations"].toInt();
+
+    TransactionItem tx{
+        it.toObject()["category"].toString(),
+        (qint64)it.toObject()["time"].toInt(),
+        address,
+        it.toObject()["txid"].toString(),
+        CAmount::fromJson(it.toObject()["amount"]) + fee,
+        static_cast<long>(confirmations),
+        "", "" };
+
+    if (!address.isEmpty())
+        usedAddresses->insert(address, true);
+
+    // A tx has one entry per output/category, so key on all of them
+    QString key = tx.txid % ":" % tx.type % ":" % address % ":" % QString::number(it.toObject()["vout"].toInt());
+    entries[key] = TTxEntry{ tx, confirmations > 0 ? tipHeight - confirmations + 1 : 0 };
+}
+
+// Update the confirmations from the current height, and send the txs to the model
+void RPC::publishTTransactions(int tipHeight) {
+    QList<TransactionItem> txdata;
+    for (const auto& entry : tTransactions) {
+        auto tx = entry.tx;
+        if (entry.height > 0)
+            tx.confirmations = std::max(tipHeight - entry.height + 1, 1);
+
+        txdata.push_back(tx);
+    }
+
+    // Update model data, which updates the table view
+    transactionsTableModel->addTData(txdata);        
+}
+
+// Read sent Z transactions from the sent tx store, which only reads the file again if it changed.
 void RPC::refreshSentZTrans() {
     if  (conn == nullptr) 
         return noConnection();
@@ -1115,30 +1654,25 @@ void RPC::refreshSentZTrans() {
         return;
     }
 
+    // Txs that are reorgSafetyDepth deep have their confirmations computed from the block 
+    // height stored in the file, so only look up the unconfirmed and the recent ones.
     QList<QString> txids;
 
     for (auto sentTx: sentZTxs) {
-        txids.push_back(sentTx.txid);
+        if (sentTx.confirmations < Settings::reorgSafetyDepth)
+            txids.push_back(sentTx.txid);
     }
 
-    // Look up all the txids to get the confirmation count for them. 
-    conn->doBatchRPC<QString>(txids,
-        [=] (QString txid) {
-            QJsonObject payload = {
-                {"jsonrpc", "1.0"},
-                {"id", "senttxid"},
-                {"method", "gettransaction"},
-                {"params", QJsonArray {txid}}
-            };
+    if (txids.isEmpty()) {
+        transactionsTableModel->addZSentData(sentZTxs);
+        return;
+    }
 
-            return payload;
-        },          
+    // Look up all the txids to get the confirmation count for them. 
+    conn->doGetTransactions(txids,
         [=] (QMap<QString, QJsonValue>* txidList) {
             auto newSentZTxs = sentZTxs;
             // Update the original sent list with the confirmation count
-            // TODO: This whole thing is kinda inefficient. We should probably just update the file
-            // with the confirmed block number, so we don't have to keep calling gettransaction for the
-            // sent items.
             for (TransactionItem& sentTx: newSentZTxs) {
                 auto j = txidList->value(sentTx.txid);
                 if (j.isNull())
@@ -1148,6 +1682,9 @@ void RPC::refreshSentZTrans() {
                     sentTx.confirmations = j["confirmations"].toInt();
             }
             
+            // And remember the heights of the newly mined ones for next time
+            SentTxStore::updateConfirmations(*txidList, Settings::getInstance()->getBlockNumber());
+
             transactionsTableModel->addZSentData(newSentZTxs);
             delete txidList;
         }
@@ -1538,7 +2075,7 @@ void RPC::shutdownZcashd() {
  * Get a Sapling address from the user's wallet
  */ 
 QString RPC::getDefaultSaplingAddress() {
-    for (QString addr: *zaddresses) {
+    for (QString addr: snapshot->zaddresses) {
         if (Settings::getInstance()->isSaplingAddress(addr))
             return addr;
     }
@@ -1547,8 +2084,8 @@ QString RPC::getDefaultSaplingAddress() {
 }
 
 QString RPC::getDefaultTAddress() {
-    if (getAllTAddresses()->length() > 0)
-        return getAllTAddresses()->at(0);
+    if (snapshot->taddresses.length() > 0)
+        return snapshot->taddresses.at(0);
     else 
         return QString();
 }
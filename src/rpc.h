@@ -3,8 +3,11 @@
 
 #include "precompiled.h"
 
+#include "camount.h"
+#include "walletsnapshot.h"
 #include "balancestablemodel.h"
 #include "txtablemodel.h"
+#include "txsearch.h"
 #include "ui_mainwindow.h"
 #include "mainwindow.h"
 #include "connection.h"
@@ -16,12 +19,19 @@ struct TransactionItem {
     qint64          datetime;
     QString         address;
     QString         txid;
-    double          amount;
+    CAmount         amount;
     long            confirmations;
     QString         fromAddr;
     QString         memo;
 };
 
+// A transparent wallet tx entry (as returned by listtransactions), and the block height it
+// was mined at, or 0 if it's unconfirmed.
+struct TTxEntry {
+    TransactionItem tx;
+    int             height;
+};
+
 struct WatchedTx {
     QString opid;
     Tx tx;
@@ -71,12 +81,20 @@ public:
     void addNewTxToWatch(const QString& newOpid, WatchedTx wtx); 
 
     const TxTableModel*               getTransactionsModel() { return transactionsTableModel; }
-    const QList<QString>*             getAllZAddresses()     { return zaddresses; }
-    const QList<QString>*             getAllTAddresses()     { return taddresses; }
-    const QList<UnspentOutput>*       getUTXOs()             { return utxos; }
-    const QMap<QString, double>*      getAllBalances()       { return allBalances; }
+    TxFilterProxyModel*               getTransactionsProxy() { return transactionsProxyModel; }
     const QMap<QString, bool>*        getUsedAddresses()     { return usedAddresses; }
 
+    // The wallet as of the last refresh. Hold on to the returned pointer for as long as
+    // the data is needed, it's never modified.
+    std::shared_ptr<const WalletSnapshot> getSnapshot()      { return snapshot; }
+
+    // Parts of the current snapshot, or nullptr if they haven't been loaded yet. These are only
+    // valid until the next refresh.
+    const QList<QString>*             getAllZAddresses()     { return snapshot->zaddressesLoaded ? &snapshot->zaddresses : nullptr; }
+    const QList<QString>*             getAllTAddresses()     { return snapshot->taddressesLoaded ? &snapshot->taddresses : nullptr; }
+    const QList<UnspentOutput>*       getUTXOs()             { return snapshot->balancesLoaded   ? &snapshot->utxos      : nullptr; }
+    const QMap<QString, CAmount>*     getAllBalances()       { return snapshot->balancesLoaded   ? &snapshot->balances   : nullptr; }
+
     void newZaddr(const std::function<void(QJsonValue)>& cb);
     void newTaddr(const std::function<void(QJsonValue)>& cb);
 
@@ -105,23 +123,47 @@ public:
 private:
     void refreshBalances();
 
-    void refreshTransactions();    
+    void refreshTransactions(int tipHeight);
+    void fetchAllTTransactions(int tipHeight);
+    void fetchTTransactionsPage(int skip, int tipHeight, QString cursor, 
+                                std::shared_ptr<QMap<QString, TTxEntry>> entries);
+    void fetchTTransactionsSince(int tipHeight);
+    void addTTransaction(QMap<QString, TTxEntry>& entries, const QJsonValue& it, int tipHeight);
+    void publishTTransactions(int tipHeight);
     void refreshMigration();
     void refreshSentZTrans();
+    void refreshNodeInfo();
+    void refreshSafeNodes();
+
+    bool isTabVisible(QWidget* tab);
     void refreshReceivedZTrans(QList<QString> zaddresses);
 
-    bool processUnspent     (const QJsonValue& reply, QMap<QString, double>* newBalances, QList<UnspentOutput>* newUtxos);
-    void updateUI           (bool anyUnconfirmed);
+    bool processUnspent     (const QJsonValue& reply, QMap<QString, CAmount>* newBalances, QList<UnspentOutput>* newUtxos);
+    void updateUI           ();
+
+    void publishSnapshot    (const std::function<void(WalletSnapshot&)>& update);
+
+    void loadHistoryCache();
+    void saveHistoryCache();
+    void dropHistoryCache();
+    void scheduleHistorySave();
 
     void getInfoThenRefresh(bool force);
 
-    void getBalance(const std::function<void(QJsonValue)>& cb);
+    void watchForNewBlocks();
+    void readDebugLog(const QString& path);
+
+    void getBalance(const std::function<void(QJsonValue)>& cb, 
+                    const std::function<void(QNetworkReply*, const QJsonValue&)>& err);
     QJsonValue makePayload(QString method, QString params);
     QJsonValue makePayload(QString method);
 
-    void getTransparentUnspent  (const std::function<void(QJsonValue)>& cb);
-    void getZUnspent            (const std::function<void(QJsonValue)>& cb);
-    void getTransactions        (const std::function<void(QJsonValue)>& cb);
+    void getTransparentUnspent  (const std::function<void(QJsonValue)>& cb,
+                                 const std::function<void(QNetworkReply*, const QJsonValue&)>& err);
+    void getZUnspent            (const std::function<void(QJsonValue)>& cb,
+                                 const std::function<void(QNetworkReply*, const QJsonValue&)>& err);
+    void getTransactions        (int count, int skip, const std::function<void(QJsonValue)>& cb,
+                                 const std::function<void(QNetworkReply*, const QJsonValue&)>& err);
     void getZAddresses          (const std::function<void(QJsonValue)>& cb);
     void getTAddresses          (const std::function<void(QJsonValue)>& cb);
 
@@ -129,21 +171,45 @@ private:
     Connection*                 conn                        = nullptr;
     std::shared_ptr<QProcess>   ezcashd                     = nullptr;
 
-    QList<UnspentOutput>*       utxos                       = nullptr;
-    QMap<QString, double>*      allBalances                 = nullptr;
+    std::shared_ptr<const WalletSnapshot> snapshot;
     QMap<QString, bool>*        usedAddresses               = nullptr;
-    QList<QString>*             zaddresses                  = nullptr;
-    QList<QString>*             taddresses                  = nullptr;
     
     QMap<QString, WatchedTx>    watchingOps;
 
+    // Transparent txs synced so far, and the block (hash and height) they're synced up to. 
+    // Only the txs after this block are fetched on the next refresh.
+    QMap<QString, TTxEntry>     tTransactions;
+    QString                     tSyncBlock;
+    int                         tSyncHeight                 = 0;
+    bool                        tSyncInProgress             = false;
+
+    // Number of transparent txs fetched per listtransactions call on a full sync
+    static const int            tTxPageSize                 = 1000;
+
     TxTableModel*               transactionsTableModel      = nullptr;
+    TxFilterProxyModel*         transactionsProxyModel      = nullptr;
     BalancesTableModel*         balancesTableModel          = nullptr;
 
     QTimer*                     timer;
     QTimer*                     txTimer;
     QTimer*                     priceTimer;
 
+    // Watches the local safecoind's debug.log for new blocks and wallet txs
+    QFileSystemWatcher*         logWatcher                  = nullptr;
+    qint64                      debugLogOffset              = 0;
+    bool                        logWatcherTestnet           = false;   // Network of the watched debug.log
+    QTimer*                     notifyTimer;
+    static const int            notifyDelay                 = 1000;
+    bool                        notifyForce                 = false;
+
+    // Saves the history cache a little while after the wallet changes, so a burst of
+    // updates is only written once
+    QTimer*                     historySaveTimer            = nullptr;
+    std::shared_ptr<const WalletSnapshot> savedSnapshot;
+    quint64                     savedHistoryVersion         = 0;
+    bool                        historyTestnet              = false;    // Network of the saved history
+    static const int            historySaveDelay            = 30 * 1000;
+
     Ui::MainWindow*             ui;
     MainWindow*                 main;
     Turnstile*                  turnstile;
@@ -159,16 +159,10 @@ void MainWindow::editSchedule() {
 }
 
 void MainWindow::updateLabelsAutoComplete() {
-    QList<QString> list;
-    auto labels = AddressBook::getInstance()->getAllAddressLabels();
-    
-    std::transform(labels.begin(), labels.end(), std::back_inserter(list), [=] (auto la) -> QString {
-        return la.first % "/" % la.second;
-    });
-    
-    delete labelCompleter;
-    labelCompleter = new QCompleter(list, this);
-    labelCompleter->setCaseSensitivity(Qt::CaseInsensitive);
+    // The address book keeps the completions up to date as labels change, so the completer 
+    // only has to be made once
+    if (labelCompleter == nullptr)
+        labelCompleter = new LabelCompleter(AddressBook::getInstance()->getCompletionModel(), this);
 
     // Then, find all the address fields and update the completer.
     QRegularExpression re("Address[0-9]+", QRegularExpression::CaseInsensitiveOption);
@@ -178,14 +172,15 @@ void MainWindow::updateLabelsAutoComplete() {
 }
 
 void MainWindow::setDefaultPayFrom() {
+    auto snapshot = rpc->getSnapshot();
     auto findMax = [=] (QString startsWith) {
-        double max_amt = 0;
-        int    idx     = -1;
+        CAmount max_amt;
+        int     idx     = -1;
 
         for (int i=0; i < ui->inputsCombo->count(); i++) {
             auto addr = ui->inputsCombo->itemText(i);
             if (addr.startsWith(startsWith)) {
-                auto amt = rpc->getAllBalances()->value(addr);
+                auto amt = snapshot->balances.value(addr);
                 if (max_amt < amt) {
                     max_amt = amt;
                     idx = i;
@@ -208,16 +203,17 @@ void MainWindow::setDefaultPayFrom() {
 };
 
 void MainWindow::updateFromCombo() {
-    if (!rpc || !rpc->getAllBalances())
+    if (!rpc || !rpc->getSnapshot()->balancesLoaded)
         return;
 
+    auto snapshot     = rpc->getSnapshot();
     auto lastFromAddr = ui->inputsCombo->currentText();
 
     ui->inputsCombo->clear();
-    auto i = rpc->getAllBalances()->constBegin();
+    auto i = snapshot->balances.constBegin();
 
     // Add all the addresses into the inputs combo box
-    while (i != rpc->getAllBalances()->constEnd()) {
+    while (i != snapshot->balances.constEnd()) {
         ui->inputsCombo->addItem(i.key(), i.value());
         if (i.key() == lastFromAddr) ui->inputsCombo->setCurrentText(i.key());
 
@@ -234,7 +230,7 @@ void MainWindow::updateFromCombo() {
 
 void MainWindow::inputComboTextChanged(int index) {
     auto addr   = ui->inputsCombo->itemText(index);
-    auto bal    = rpc->getAllBalances()->value(addr);
+    auto bal    = rpc->getSnapshot()->balances.value(addr);
     auto balFmt = Settings::getDisplayFormat(bal);
 
     ui->sendAddressBalance->setText(balFmt);
@@ -506,21 +502,22 @@ void MainWindow::clearSendForm() {
 void MainWindow::maxAmountChecked(int checked) {
     if (checked == Qt::Checked) {
         ui->Amount1->setReadOnly(true);
-        if (rpc->getAllBalances() == nullptr) return;
+        auto snapshot = rpc->getSnapshot();
+        if (!snapshot->balancesLoaded) return;
            
         // Calculate maximum amount
-        double sumAllAmounts = 0.0;
+        CAmount sumAllAmounts;
         // Calculate all other amounts
         int totalItems = ui->sendToWidgets->children().size() - 2;   // The last one is a spacer, so ignore that        
         // Start counting the sum skipping the first one, because the MAX button is on the first one, and we don't
         // want to include it in the sum. 
         for (int i=1; i < totalItems; i++) {
             auto amt  = ui->sendToWidgets->findChild<QLineEdit*>(QString("Amount")  % QString::number(i+1));
-            sumAllAmounts += amt->text().toDouble();
+            sumAllAmounts += CAmount::fromDecimalString(amt->text());
         }
 
         if (Settings::getInstance()->getAllowCustomFees()) {
-            sumAllAmounts = ui->minerFeeAmt->text().toDouble();
+            sumAllAmounts = CAmount::fromDecimalString(ui->minerFeeAmt->text());
         }
         else {
             sumAllAmounts += Settings::getMinerFee();
@@ -528,8 +525,8 @@ void MainWindow::maxAmountChecked(int checked) {
 
         auto addr = ui->inputsCombo->currentText();
 
-        auto maxamount  = rpc->getAllBalances()->value(addr) - sumAllAmounts;
-        maxamount       = (maxamount < 0) ? 0 : maxamount;
+        auto maxamount  = snapshot->balances.value(addr) - sumAllAmounts;
+        maxamount       = (maxamount < CAmount()) ? CAmount() : maxamount;
             
         ui->Amount1->setText(Settings::getDecimalString(maxamount));
     } else if (checked == Qt::Unchecked) {
@@ -550,13 +547,13 @@ Tx MainWindow::createTxFromSendPage() {
 
     // For each addr/amt in the sendTo tab
     int totalItems = ui->sendToWidgets->children().size() - 2;   // The last one is a spacer, so ignore that        
-    double totalAmt = 0;
+    CAmount totalAmt;
     for (int i=0; i < totalItems; i++) {
         QString addr = ui->sendToWidgets->findChild<QLineEdit*>(QString("Address") % QString::number(i+1))->text().trimmed();
         // Remove label if it exists
         addr = AddressBook::addressFromAddressLabel(addr);
         
-        double  amt  = ui->sendToWidgets->findChild<QLineEdit*>(QString("Amount")  % QString::number(i+1))->text().trimmed().toDouble();        
+        CAmount amt  = CAmount::fromDecimalString(ui->sendToWidgets->findChild<QLineEdit*>(QString("Amount")  % QString::number(i+1))->text());
         totalAmt += amt;
         QString memo = ui->sendToWidgets->findChild<QLabel*>(QString("MemoTxt")  % QString::number(i+1))->text().trimmed();
         
@@ -564,13 +561,14 @@ Tx MainWindow::createTxFromSendPage() {
     }
 
     if (Settings::getInstance()->getAllowCustomFees()) {
-        tx.fee = ui->minerFeeAmt->text().toDouble();
+        tx.fee = CAmount::fromDecimalString(ui->minerFeeAmt->text());
     } else {
         tx.fee = Settings::getMinerFee();
     }
 
     if (Settings::getInstance()->getAutoShield() && sendChangeToSapling) {
-        auto saplingAddr = std::find_if(rpc->getAllZAddresses()->begin(), rpc->getAllZAddresses()->end(), [=](auto i) -> bool { 
+        auto snapshot    = rpc->getSnapshot();
+        auto saplingAddr = std::find_if(snapshot->zaddresses.begin(), snapshot->zaddresses.end(), [=](auto i) -> bool { 
             // We're finding a sapling address that is not one of the To addresses, because zcash doesn't allow duplicated addresses
             bool isSapling = Settings::getInstance()->isSaplingAddress(i); 
             if (!isSapling) return false;
@@ -584,10 +582,10 @@ Tx MainWindow::createTxFromSendPage() {
             return true;
         });
 
-        if (saplingAddr != rpc->getAllZAddresses()->end()) {
-            double change = rpc->getAllBalances()->value(tx.fromAddr) - totalAmt - tx.fee;
+        if (saplingAddr != snapshot->zaddresses.end()) {
+            CAmount change = snapshot->balances.value(tx.fromAddr) - totalAmt - tx.fee;
 
-            if (Settings::getDecimalString(change) != "0") {
+            if (change != CAmount()) {
                 QString changeMemo = tr("Change from ") + tx.fromAddr;
                 tx.toAddrs.push_back(ToFields{ *saplingAddr, change, changeMemo, changeMemo.toUtf8().toHex() });
             }
@@ -657,7 +655,7 @@ bool MainWindow::confirmTx(Tx tx, RecurringPaymentInfo* rpi) {
     
     // For each addr/amt/memo, construct the JSON and also build the confirm dialog box    
     int row = 0;
-    double totalSpending = 0;
+    CAmount totalSpending;
 
     for (int i=0; i < tx.toAddrs.size(); i++) {
         auto toAddr = tx.toAddrs[i];
@@ -762,10 +760,11 @@ bool MainWindow::confirmTx(Tx tx, RecurringPaymentInfo* rpi) {
     // And FromAddress in the confirm dialog 
     confirm.sendFrom->setText(fnSplitAddressForWrap(tx.fromAddr));
     confirm.sendFrom->setFont(fixedFont);    
+    auto fromBalance = rpc->getSnapshot()->balances.value(tx.fromAddr);
     QString tooltip = tr("Current balance      : ") +
-        Settings::getZECUSDDisplayFormat(rpc->getAllBalances()->value(tx.fromAddr));
+        Settings::getZECUSDDisplayFormat(fromBalance);
     tooltip += "\n" + tr("Balance after this Tx: ") +
-        Settings::getZECUSDDisplayFormat(rpc->getAllBalances()->value(tx.fromAddr) - totalSpending);
+        Settings::getZECUSDDisplayFormat(fromBalance - totalSpending);
     confirm.sendFrom->setToolTip(tooltip);
 
     // Show the dialog and submit it if the user confirms
@@ -911,7 +910,7 @@ QString MainWindow::doSendTxValidations(Tx tx) {
 
         // This technically shouldn't be possible, but issue #62 seems to have discovered a bug
         // somewhere, so just add a check to make sure. 
-        if (toAddr.amount < 0) {
+        if (toAddr.amount < CAmount()) {
             return QString(tr("Amount for address '%1' is invalid!").arg(toAddr.addr));
         }
     }
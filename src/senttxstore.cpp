@@ -1,10 +1,18 @@
 #include "senttxstore.h"
 #include "settings.h"
+#include "trace.h"
 
-/// Get the location of the app data file to be written. 
-QString SentTxStore::writeableFile() {
-    auto filename = QStringLiteral("senttxstore.dat");
+SentTxStore* SentTxStore::instance = nullptr;
+
+SentTxStore* SentTxStore::getInstance() {
+    if (instance == nullptr)
+        instance = new SentTxStore();
+
+    return instance;
+}
 
+/// Get the location of the app data file to be written. 
+QString SentTxStore::writeableFile(const QString& filename) {
     auto dir = QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
     if (!dir.exists())
         QDir().mkpath(dir.absolutePath());
@@ -18,32 +26,268 @@ QString SentTxStore::writeableFile() {
 
 // delete the sent history. 
 void SentTxStore::deleteHistory() {
-    QFile data(writeableFile());
-    data.remove();
+    QFile::remove(logFile());
+    QFile::remove(legacyFile());
+
+    auto store = getInstance();
+    store->cacheValid = false;
+    store->notifyChanged();
+}
+
+void SentTxStore::onChanged(const std::function<void()>& cb) {
+    auto store = getInstance();
+    store->listeners.push_back(cb);
+    store->watchFile();
+}
+
+void SentTxStore::notifyChanged() {
+    for (const auto& cb : listeners) {
+        cb();
+    }
+}
+
+/**
+ * Watch the log for changes made by someone else. Our own writes show up here too, but then 
+ * the file is still the way we left it, so they're ignored.
+ */
+void SentTxStore::watchFile() {
+    if (listeners.isEmpty())
+        return;
+
+    if (watcher == nullptr) {
+        watcher = new QFileSystemWatcher();
+        QObject::connect(watcher, &QFileSystemWatcher::fileChanged, [=] (const QString& path) {
+            // Renaming a new file over it (see writeCompacted) stops the watch
+            if (!watcher->files().contains(path) && QFile::exists(path))
+                watcher->addPath(path);
+
+            if (path != cachedFile || !cacheValid || isFileUnchanged())
+                return;
+
+            TRACE_INFO(traceStorage) << "Sent tx log was changed outside the wallet";
+            cacheValid = false;
+            notifyChanged();
+        });
+    }
+
+    // The file moves when we switch between mainnet and testnet
+    auto file = logFile();
+    if (!watcher->files().isEmpty() && watcher->files() != QStringList{ file })
+        watcher->removePaths(watcher->files());
+    if (watcher->files().isEmpty() && QFile::exists(file))
+        watcher->addPath(file);
+}
+
+bool SentTxStore::isFileUnchanged() const {
+    QFileInfo info(cachedFile);
+    if (!info.exists())
+        return fileSize < 0;
+
+    return info.size() == fileSize && info.lastModified() == fileModified;
+}
+
+void SentTxStore::rememberFileState() {
+    QFileInfo info(cachedFile);
+    fileSize     = info.exists() ? info.size() : -1;
+    fileModified = info.exists() ? info.lastModified() : QDateTime();
+}
+
+/**
+ * Move the txs from the old JSON array file into the log. The old file is only removed once
+ * the log has been written, so if we crash in between, it's just migrated again.
+ */
+void SentTxStore::migrateLegacyFile() {
+    QFile data(legacyFile());
+    if (!data.exists())
+        return;
+
+    if (QFile::exists(logFile())) {
+        // Already migrated, but we didn't get to remove it
+        data.remove();
+        return;
+    }
+
+    if (!data.open(QFile::ReadOnly))
+        return;
+
+    auto jsonDoc = QJsonDocument::fromJson(data.readAll());
     data.close();
+
+    QByteArray lines;
+    for (const auto& i : jsonDoc.array()) {
+        auto sentTx = i.toObject();
+        sentTx["op"] = "add";
+        lines += QJsonDocument(sentTx).toJson(QJsonDocument::Compact);
+        lines += '\n';
+    }
+
+    TRACE_INFO(traceStorage) << "Migrating" << jsonDoc.array().size() << "sent txs to the sent tx log";
+
+    QSaveFile writer(logFile());
+    if (writer.open(QFile::WriteOnly)) {
+        writer.write(lines);
+        if (writer.commit())
+            data.remove();
+    }
+}
+
+// The parsed log, read again only if it's not the file we have in memory any more
+const QList<SentTxStore::SentTx>& SentTxStore::load() {
+    migrateLegacyFile();
+
+    if (!cacheValid || cachedFile != logFile() || !isFileUnchanged())
+        readLog();
+
+    return txs;
+}
+
+/**
+ * Read the log, applying the records in order. If the last line doesn't parse, it's from a 
+ * write that didn't finish, so the log is cut back to the last complete record. 
+ */
+void SentTxStore::readLog() {
+    txs.clear();
+    indexByTxid.clear();
+    numRecords = 0;
+    cachedFile = logFile();
+
+    QFile data(cachedFile);
+    if (data.open(QFile::ReadWrite)) {
+        qint64 validLength = 0;
+
+        while (!data.atEnd()) {
+            auto line = data.readLine();
+            if (line.trimmed().isEmpty()) {
+                validLength = data.pos();
+                continue;
+            }
+
+            QJsonParseError error;
+            auto record = QJsonDocument::fromJson(line, &error).object();
+            if (error.error != QJsonParseError::NoError || !line.endsWith('\n')) {
+                if (data.atEnd()) {
+                    TRACE_WARN(traceStorage) << "Dropping incomplete record at the end of the sent tx log";
+                    break;
+                }
+
+                TRACE_WARN(traceStorage) << "Skipping unreadable record in the sent tx log";
+                validLength = data.pos();
+                continue;
+            }
+
+            validLength = data.pos();
+            applyRecord(record);
+        }
+
+        if (validLength < data.size())
+            data.resize(validLength);
+
+        data.close();
+    }
+
+    rememberFileState();
+    cacheValid = true;
+    watchFile();
+}
+
+void SentTxStore::applyRecord(const QJsonObject& record) {
+    numRecords++;
+
+    auto op   = record["op"].toString();
+    auto txid = record["txid"].toString();
+    if (op == "add") {
+        SentTx sentTx;
+        sentTx.record = record;
+        sentTx.height = record["height"].toInt();
+        sentTx.item   = TransactionItem{"send", (qint64)record["datetime"].toVariant().toLongLong(), 
+                                        record["address"].toString(), 
+                                        txid, 
+                                        CAmount::fromJson(record["amount"]) + CAmount::fromJson(record["fee"]), 
+                                        0, record["from"].toString(), ""};
+
+        indexByTxid[txid] = txs.size();
+        txs.push_back(sentTx);
+    } else if (op == "mined" && indexByTxid.contains(txid)) {
+        auto& sentTx = txs[indexByTxid[txid]];
+        sentTx.height = record["height"].toInt();
+        if (sentTx.height > 0) {
+            sentTx.record["height"]    = sentTx.height;
+            sentTx.record["blockhash"] = record["blockhash"];
+        } else {
+            sentTx.record.remove("height");
+            sentTx.record.remove("blockhash");
+        }
+    }
+}
+
+void SentTxStore::appendRecords(const QList<QJsonObject>& records) {
+    // Bring the cache up to date first, so the new records can just be applied to it
+    load();
+
+    QByteArray lines;
+    for (const auto& record : records) {
+        lines += QJsonDocument(record).toJson(QJsonDocument::Compact);
+        lines += '\n';
+    }
+
+    QFile writer(cachedFile);
+    if (writer.open(QFile::ReadWrite | QFile::Append)) {
+        // If the last write didn't finish, start on a new line so this one can still be read
+        if (writer.size() > 0 && writer.seek(writer.size() - 1) && writer.peek(1) != "\n")
+            lines.prepend('\n');
+
+        writer.write(lines);
+        writer.flush();
+    }
+    writer.close();
+
+    for (const auto& record : records) {
+        applyRecord(record);
+    }
+
+    rememberFileState();
+    watchFile();
+
+    // Every height change adds a record, so compact the log every now and then
+    if (numRecords > txs.size() + compactionSlack)
+        writeCompacted();
+}
+
+// Replace the log with a single "add" record for each tx. The new log is written next to the
+// old one and renamed over it, so a crash leaves one or the other.
+bool SentTxStore::writeCompacted() {
+    QSaveFile writer(cachedFile);
+    if (!writer.open(QFile::WriteOnly))
+        return false;
+
+    for (const auto& sentTx : txs) {
+        writer.write(QJsonDocument(sentTx.record).toJson(QJsonDocument::Compact));
+        writer.write("\n");
+    }
+
+    if (!writer.commit())
+        return false;
+
+    numRecords = txs.size();
+    rememberFileState();
+    return true;
 }
 
 QList<TransactionItem> SentTxStore::readSentTxFile() {
-    QFile data(writeableFile());
-    if (!data.exists()) {
-        return QList<TransactionItem>();
-    }
-    
-    QJsonDocument jsonDoc;
-    
-    data.open(QFile::ReadOnly);    
-    jsonDoc = QJsonDocument::fromJson(data.readAll());
-    data.close();
+    const auto& txs = getInstance()->load();
 
     QList<TransactionItem> items;
+    items.reserve(txs.size());
+
+    // Txs that have been mined have their block height recorded, so we can work out the 
+    // confirmations without asking safecoind
+    int tipHeight = Settings::getInstance()->getBlockNumber();
+
+    for (const auto& sentTx : txs) {
+        auto t = sentTx.item;
+        if (sentTx.height > 0 && tipHeight >= sentTx.height)
+            t.confirmations = tipHeight - sentTx.height + 1;
 
-    for (auto i : jsonDoc.array()) {
-        auto sentTx = i.toObject();
-        TransactionItem t{"send", (qint64)sentTx["datetime"].toVariant().toLongLong(), 
-                          sentTx["address"].toString(), 
-                          sentTx["txid"].toString(), 
-                          sentTx["amount"].toDouble() + sentTx["fee"].toDouble(), 
-                          0, sentTx["from"].toString(), ""};
         items.push_back(t);
     }
 
@@ -60,26 +304,8 @@ void SentTxStore::addToSentTx(Tx tx, QString txid) {
     if (! Settings::isZAddress(tx.fromAddr)) 
         return;
 
-    QFile data(writeableFile());
-    QJsonDocument jsonDoc;
-
-    // If data doesn't exist, then create a blank one
-    if (!data.exists()) {
-        QJsonArray a;
-        jsonDoc.setArray(a);
-
-        QFile newFile(writeableFile());
-        newFile.open(QFile::WriteOnly);
-        newFile.write(jsonDoc.toJson());
-        newFile.close();
-    } else {
-        data.open(QFile::ReadOnly);    
-        jsonDoc = QJsonDocument().fromJson(data.readAll());
-        data.close();
-    }
-
     // Calculate total amount in this tx
-    double totalAmount = 0;
+    CAmount totalAmount;
     for (auto i : tx.toAddrs) {
         totalAmount += i.amount;
     }
@@ -94,22 +320,54 @@ void SentTxStore::addToSentTx(Tx tx, QString txid) {
         }
     }
 
-    auto list = jsonDoc.array();
     QJsonObject txItem;
+    txItem["op"]        = "add";
     txItem["type"]      = "sent";
     txItem["from"]      = tx.fromAddr;
     txItem["datetime"]  = QDateTime::currentMSecsSinceEpoch() / (qint64)1000;
     txItem["address"]   = toAddresses;
     txItem["txid"]      = txid;
-    txItem["amount"]    = -totalAmount;
-    txItem["fee"]       = -tx.fee;
-    list.append(txItem);
+    txItem["amount"]    = (-totalAmount).toDecimalString();
+    txItem["fee"]       = (-tx.fee).toDecimalString();
+
+    auto store = getInstance();
+    store->appendRecords({ txItem });
+    store->notifyChanged();
+}
 
-    jsonDoc.setArray(list);
+/**
+ * Record the block height and hash of each sent tx that has been mined, from its gettransaction
+ * response in txs. If a tx was reorged out, its height is cleared again.
+ */
+void SentTxStore::updateConfirmations(const QMap<QString, QJsonValue>& txs, int tipHeight) {
+    if (tipHeight <= 0)
+        return;
 
-    QFile writer(writeableFile());
-    if (writer.open(QFile::WriteOnly | QFile::Truncate)) {
-        writer.write(jsonDoc.toJson());
-    } 
-    writer.close();
+    auto store = getInstance();
+
+    QList<QJsonObject> records;
+    for (const auto& sentTx : store->load()) {
+        auto j = txs.value(sentTx.item.txid);
+        if (j.isNull() || j["confirmations"].isUndefined())
+            continue;
+
+        int confirmations = j["confirmations"].toInt();
+        int height        = confirmations > 0 ? tipHeight - confirmations + 1 : 0;
+        if (sentTx.height == height)
+            continue;
+
+        QJsonObject record{
+            {"op",     "mined"},
+            {"txid",   sentTx.item.txid},
+            {"height", height}
+        };
+        if (height > 0)
+            record["blockhash"] = j["blockhash"].toString();
+
+        records.push_back(record);
+    }
+
+    // The confirmations are worked out from the heights, so the txs themselves didn't change
+    if (!records.isEmpty())
+        store->appendRecords(records);
 }
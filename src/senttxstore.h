@@ -5,16 +5,70 @@
 #include "mainwindow.h"
 #include "rpc.h"
 
+/**
+ * The z txs sent from this wallet, which safecoind doesn't keep track of. They're stored as a 
+ * log with one JSON record per line: an "add" record for each sent tx, and a "mined" record 
+ * whenever its block height changes. New records are only ever appended, and the log is 
+ * compacted to one record per tx when it has grown too much.
+ *
+ * The parsed log is kept in memory. It's only read again if the file was changed by someone 
+ * else (eg. another copy of the wallet), which is noticed from its size and modification time. 
+ */
 class SentTxStore {
 public:
     static void deleteHistory();
 
     static QList<TransactionItem> readSentTxFile();
     static void                   addToSentTx(Tx tx, QString txid);
+    static void                   updateConfirmations(const QMap<QString, QJsonValue>& txs, int tipHeight);
+
+    // Called whenever sent txs are added or the history is deleted, by us or by someone else
+    static void                   onChanged(const std::function<void()>& cb);
 
 private:
-    static QString writeableFile();
-    
+    struct SentTx {
+        QJsonObject     record;         // The "add" record, with the current height
+        TransactionItem item;
+        int             height;
+    };
+
+    static SentTxStore* getInstance();
+    static SentTxStore* instance;
+
+    static QString writeableFile(const QString& filename);
+    static QString logFile()        { return writeableFile(QStringLiteral("senttxstore.log")); }
+
+    // The old format, a single JSON array that was rewritten on every change
+    static QString legacyFile()     { return writeableFile(QStringLiteral("senttxstore.dat")); }
+    static void    migrateLegacyFile();
+
+    // The current state of every tx, in the order they were sent
+    const QList<SentTx>&    load();
+    void                    readLog();
+    void                    applyRecord(const QJsonObject& record);
+    void                    appendRecords(const QList<QJsonObject>& records);
+    bool                    writeCompacted();
+
+    // Whether the file is still the one we last read or wrote
+    bool                    isFileUnchanged() const;
+    void                    rememberFileState();
+
+    void                    watchFile();
+    void                    notifyChanged();
+
+    QString                             cachedFile;
+    bool                                cacheValid      = false;
+    QList<SentTx>                       txs;
+    QHash<QString, int>                 indexByTxid;
+    int                                 numRecords      = 0;
+    QDateTime                           fileModified;
+    qint64                              fileSize        = -1;
+
+    QFileSystemWatcher*                 watcher         = nullptr;
+    QList<std::function<void()>>        listeners;
+
+    // Compact once there are this many more records than txs
+    static const int                    compactionSlack = 1000;
 };
 
 #endif // SENTTXSTORE_H
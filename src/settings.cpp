@@ -2,6 +2,7 @@
 // Released under the GPLv3
 #include "mainwindow.h"
 #include "settings.h"
+#include "trace.h"
 
 Settings* Settings::instance = nullptr;
 
@@ -32,6 +33,26 @@ void Settings::setAllowFetchPrices(bool allow) {
      QSettings().setValue("options/allowfetchprices", allow);
 }
 
+int Settings::getBatchRPCSize() {
+    // Max number of calls sent to safecoind in a single JSON-RPC batch request.
+    // 1 disables batching.
+    return QSettings().value("connection/batchrpcsize", 250).toInt();
+}
+
+void Settings::setBatchRPCSize(int size) {
+     QSettings().setValue("connection/batchrpcsize", size);
+}
+
+int Settings::getRecurringBatchSize() {
+    // Max number of due recurring payments from the same address that are paid in a single
+    // z_sendmany. 1 disables batching, so every payment is its own tx.
+    return QSettings().value("options/recurringbatchsize", 1).toInt();
+}
+
+void Settings::setRecurringBatchSize(int size) {
+    QSettings().setValue("options/recurringbatchsize", size);
+}
+
 Explorer Settings::getExplorer() {
     // Load from the QT Settings.
     QSettings s;
@@ -187,24 +208,24 @@ double Settings::get_price(QString currency) {
 
     auto search = prices.find(currency);
     if (search != prices.end()) {
-        qDebug() << "Found price of " << ticker << " = " << search->second;
+        TRACE_DEBUG(tracePrices) << "Found price of " << ticker << " = " << search->second;
         return search->second;
     } else {
-        qDebug() << "Could not find price of" << ticker << "!!!";
+        TRACE_DEBUG(tracePrices) << "Could not find price of" << ticker << "!!!";
         return 0.0;
     }
 }
 
 void Settings::set_price(QString curr, double price) {
     QString ticker = curr;
-    qDebug() << "Setting price of " << ticker << "=" << QString::number(price);
+    TRACE_DEBUG(tracePrices) << "Setting price of " << ticker << "=" << QString::number(price);
     prices.insert( std::make_pair(curr, price) );
     prices.insert( std::make_pair(curr, price) );
 }
 
 void Settings::set_volume(QString curr, double volume) {
     QString ticker = curr;
-    qDebug() << "Setting volume of " << ticker << "=" << QString::number(volume);
+    TRACE_DEBUG(tracePrices) << "Setting volume of " << ticker << "=" << QString::number(volume);
     volumes.insert( std::make_pair(curr, volume) );
 }
 
@@ -213,17 +234,17 @@ double Settings::get_volume(QString currency) {
     QString ticker = currency;
     auto search = volumes.find(currency);
     if (search != volumes.end()) {
-        qDebug() << "Found volume of " << ticker << " = " << search->second;
+        TRACE_DEBUG(tracePrices) << "Found volume of " << ticker << " = " << search->second;
         return search->second;
     } else {
-        qDebug() << "Could not find volume of" << ticker << "!!!";
+        TRACE_DEBUG(tracePrices) << "Could not find volume of" << ticker << "!!!";
         return 0.0;
     }
 }
 
 void Settings::set_marketcap(QString curr, double marketcap) {
     QString ticker = curr;
-    qDebug() << "Setting marketcap of " << ticker << "=" << QString::number(marketcap);
+    TRACE_DEBUG(tracePrices) << "Setting marketcap of " << ticker << "=" << QString::number(marketcap);
     marketcaps.insert( std::make_pair(curr, marketcap) );
 }
 
@@ -232,10 +253,10 @@ double Settings::get_marketcap(QString currency) {
     QString ticker = currency;
     auto search = marketcaps.find(currency);
     if (search != marketcaps.end()) {
-        qDebug() << "Found marketcap of " << ticker << " = " << search->second;
+        TRACE_DEBUG(tracePrices) << "Found marketcap of " << ticker << " = " << search->second;
         return search->second;
     } else {
-        qDebug() << "Could not find marketcap of" << ticker << "!!!";
+        TRACE_DEBUG(tracePrices) << "Could not find marketcap of" << ticker << "!!!";
         return -1.0;
     }
 }
@@ -355,6 +376,18 @@ QString Settings::getDisplayFormat(double bal) {
     return getDecimalString(bal) % " " % Settings::getTokenName();
 }
 
+QString Settings::getDisplayFormat(const CAmount& bal) {
+    return bal.toDecimalString() % " " % Settings::getTokenName();
+}
+
+QString Settings::getZECUSDDisplayFormat(const CAmount& bal) {
+    auto usdFormat = getUSDFormat(bal);
+    if (!usdFormat.isEmpty())
+        return getDisplayFormat(bal) % " (" % usdFormat % ")";
+    else
+        return getDisplayFormat(bal);
+}
+
 QString Settings::getZECUSDDisplayFormat(double bal) {
     auto usdFormat = getUSDFormat(bal);
     if (!usdFormat.isEmpty())
@@ -438,8 +471,8 @@ bool Settings::removeFromZcashConf(QString confLocation, QString option) {
     return true;
 }
 
-double Settings::getMinerFee() {
-    return 0.0001;
+CAmount Settings::getMinerFee() {
+    return CAmount::fromqint64(10000);
 }
 
 bool Settings::isValidSaplingPrivateKey(QString pk) {
@@ -6,6 +6,7 @@
 #define SETTINGS_H
 
 #include "precompiled.h"
+#include "camount.h"
 
 struct Config {
     QString host;
@@ -93,6 +94,12 @@ public:
     bool    getCheckForUpdates();
     void    setCheckForUpdates(bool allow);
 
+    int     getBatchRPCSize();
+    void    setBatchRPCSize(int size);
+
+    int     getRecurringBatchSize();
+    void    setRecurringBatchSize(int size);
+
     bool    isSaplingActive();
     
     QString get_theme_name();
@@ -144,10 +151,15 @@ public:
 
     static QString getZECUSDDisplayFormat(double bal);
 
+    static QString getDecimalString(const CAmount& amt)         { return amt.toDecimalString(); }
+    static QString getUSDFormat(const CAmount& bal)             { return getUSDFormat(bal.toDecimalDouble()); }
+    static QString getDisplayFormat(const CAmount& bal);
+    static QString getZECUSDDisplayFormat(const CAmount& bal);
+
     static QString getTokenName();
     static QString getDonationAddr();
 
-    static double  getMinerFee();
+    static CAmount getMinerFee();
     static double  getZboardAmount();
     static QString getZboardAddr();
 
@@ -162,8 +174,12 @@ public:
 
     static const int     updateSpeed         = 10 * 1000;        // 10 sec
     static const int     quickUpdateSpeed    = 3  * 1000;        // 3 sec
+    static const int     slowUpdateSpeed     = 60 * 1000;        // 1 min, when we get notified of new blocks
     static const int     priceRefreshSpeed   = 15 * 60 * 1000;   // 15 mins
 
+    // Blocks this deep are assumed to never be reorged away
+    static const int     reorgSafetyDepth    = 10;
+
 private:
     // This class can only be accessed through Settings::getInstance()
     Settings() = default;
@@ -0,0 +1,9 @@
+#include "trace.h"
+
+Q_LOGGING_CATEGORY(traceRpc,        "safe.rpc",         QtInfoMsg)
+Q_LOGGING_CATEGORY(tracePrices,     "safe.prices",      QtInfoMsg)
+Q_LOGGING_CATEGORY(traceWebsockets, "safe.websockets",  QtInfoMsg)
+Q_LOGGING_CATEGORY(traceUi,         "safe.ui",          QtInfoMsg)
+Q_LOGGING_CATEGORY(traceStorage,    "safe.storage",     QtInfoMsg)
+Q_LOGGING_CATEGORY(traceRecurring,  "safe.recurring",   QtInfoMsg)
+Q_LOGGING_CATEGORY(traceLog,        "safe.log",         QtInfoMsg)
@@ -0,0 +1,31 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "precompiled.h"
+
+// Tracing for the busy parts of the wallet, one category per area. Debug messages are off by 
+// default, turn them on at runtime with QT_LOGGING_RULES, eg. "safe.rpc.debug=true"
+Q_DECLARE_LOGGING_CATEGORY(traceRpc)
+Q_DECLARE_LOGGING_CATEGORY(tracePrices)
+Q_DECLARE_LOGGING_CATEGORY(traceWebsockets)
+Q_DECLARE_LOGGING_CATEGORY(traceUi)
+Q_DECLARE_LOGGING_CATEGORY(traceStorage)
+Q_DECLARE_LOGGING_CATEGORY(traceRecurring)
+
+// Not traced through, but turns on the Logger's debug messages in the log file
+Q_DECLARE_LOGGING_CATEGORY(traceLog)
+
+// Use like qDebug: TRACE_DEBUG(traceRpc) << "RPC:" << method;
+// Nothing after the macro is evaluated unless the level is enabled for the category. Debug and 
+// info tracing is only compiled in when SAFE_TRACE is defined, which the debug build does.
+#ifdef SAFE_TRACE
+#define TRACE_DEBUG(category)   qCDebug(category)
+#define TRACE_INFO(category)    qCInfo(category)
+#else
+#define TRACE_DEBUG(category)   while (false) QMessageLogger().noDebug()
+#define TRACE_INFO(category)    while (false) QMessageLogger().noDebug()
+#endif
+
+#define TRACE_WARN(category)    qCWarning(category)
+
+#endif // TRACE_H
@@ -0,0 +1,292 @@
+#include "txsearch.h"
+#include "txtablemodel.h"
+
+// Parse "a..b", "a..", "..b" or just "a". Returns false if there's nothing usable.
+static bool parseRange(const QString& range, QString& from, QString& to) {
+    int dots = range.indexOf("..");
+    if (dots < 0) {
+        from = range;
+        to   = range;
+    } else {
+        from = range.left(dots);
+        to   = range.mid(dots + 2);
+    }
+
+    return !from.isEmpty() || !to.isEmpty();
+}
+
+TxSearchQuery TxSearchQuery::parse(const QString& text) {
+    TxSearchQuery q;
+
+    for (const auto& word : text.toLower().split(QRegExp("\\s+"), QString::SkipEmptyParts)) {
+        QString from, to;
+
+        if (word.startsWith("amount:")) {
+            if (!parseRange(word.mid(7), from, to))
+                continue;
+
+            bool fromOk = true, toOk = true;
+            q.minAmount = from.isEmpty() ? 0 : CAmount::fromDecimalString(from, &fromOk).toqint64();
+            q.maxAmount = to.isEmpty() ? std::numeric_limits<qint64>::max() : 
+                                         CAmount::fromDecimalString(to, &toOk).toqint64();
+            q.hasAmount = fromOk && toOk;
+        } else if (word.startsWith("date:")) {
+            if (!parseRange(word.mid(5), from, to))
+                continue;
+
+            QDate fromDate = QDate::fromString(from, Qt::ISODate);
+            QDate toDate   = QDate::fromString(to,   Qt::ISODate);
+            if ((!from.isEmpty() && !fromDate.isValid()) || (!to.isEmpty() && !toDate.isValid()))
+                continue;
+
+            // The whole of the "to" day is included
+            q.fromTime = from.isEmpty() ? 0 : QDateTime(fromDate).toSecsSinceEpoch();
+            q.toTime   = to.isEmpty() ? std::numeric_limits<qint64>::max() : 
+                                        QDateTime(toDate.addDays(1)).toSecsSinceEpoch() - 1;
+            q.hasDate  = true;
+        } else {
+            q.terms.append(word);
+        }
+    }
+
+    return q;
+}
+
+TxSearchIndex::TxSearchIndex(const TxStore& store, const QVector<int>& rowIds, quint64 dataVersion) 
+    : dataVersion(dataVersion) {
+    txids.reserve(rowIds.size());
+    addresses.reserve(rowIds.size());
+    entries.reserve(rowIds.size());
+
+    for (int id : rowIds) {
+        txids.append(Term{ store.txid(id).toLower(), id });
+
+        auto address = store.address(id).trimmed().toLower();
+        if (!address.isEmpty())
+            addresses.append(Term{ address, id });
+
+        // Split the memo into words
+        auto memo  = store.memo(id).toLower();
+        int  start = -1;
+        for (int i = 0; i <= memo.length(); i++) {
+            bool inWord = i < memo.length() && memo[i].isLetterOrNumber();
+            if (inWord && start < 0) {
+                start = i;
+            } else if (!inWord && start >= 0) {
+                memoWords.append(Term{ memo.mid(start, i - start), id });
+                start = -1;
+            }
+        }
+
+        auto amount = store.amount(id).toqint64();
+        entries.insert(id, Entry{ amount < 0 ? -amount : amount, store.datetime(id) });
+        maxSlot = std::max(maxSlot, id);
+    }
+
+    std::sort(txids.begin(), txids.end());
+    std::sort(addresses.begin(), addresses.end());
+    std::sort(memoWords.begin(), memoWords.end());
+}
+
+void TxSearchIndex::addPrefixMatches(const QVector<Term>& terms, const QString& prefix, QSet<int>& out) {
+    auto it = std::lower_bound(terms.begin(), terms.end(), Term{ prefix, 0 });
+    for (; it != terms.end() && it->text.startsWith(prefix); it++) {
+        out.insert(it->rowId);
+    }
+}
+
+bool TxSearchIndex::isInRange(const Entry& e, const TxSearchQuery& query) {
+    if (query.hasAmount && (e.amount < query.minAmount || e.amount > query.maxAmount))
+        return false;
+
+    if (query.hasDate && (e.datetime < query.fromTime || e.datetime > query.toTime))
+        return false;
+
+    return true;
+}
+
+TxSearchResult TxSearchIndex::search(const TxSearchQuery& query) const {
+    TxSearchResult result;
+    result.dataVersion = dataVersion;
+    result.slots.resize(maxSlot + 1);
+    for (int id : searchIds(query))
+        result.slots.setBit(id);
+
+    return result;
+}
+
+QSet<int> TxSearchIndex::searchIds(const TxSearchQuery& query) const {
+    QSet<int> results;
+
+    // Every word has to match
+    bool first = true;
+    for (const auto& term : query.terms) {
+        QSet<int> termMatches;
+        addPrefixMatches(txids,     term, termMatches);
+        addPrefixMatches(addresses, term, termMatches);
+        addPrefixMatches(memoWords, term, termMatches);
+
+        if (first) {
+            results = termMatches;
+            first   = false;
+        } else {
+            results.intersect(termMatches);
+        }
+
+        if (results.isEmpty())
+            return results;
+    }
+
+    if (!query.hasAmount && !query.hasDate)
+        return results;
+
+    // No words, so start from all the rows
+    if (first) {
+        results.reserve(entries.size());
+        for (auto it = entries.constBegin(); it != entries.constEnd(); it++) {
+            if (isInRange(it.value(), query))
+                results.insert(it.key());
+        }
+
+        return results;
+    }
+
+    for (auto it = results.begin(); it != results.end(); ) {
+        if (isInRange(entries.value(*it), query))
+            it++;
+        else
+            it = results.erase(it);
+    }
+
+    return results;
+}
+
+TxFilterProxyModel::TxFilterProxyModel(TxTableModel* source, QObject* parent) 
+    : QSortFilterProxyModel(parent), txModel(source) {
+    setSourceModel(source);
+
+    rebuildTimer = new QTimer(this);
+    rebuildTimer->setSingleShot(true);
+    QObject::connect(rebuildTimer, &QTimer::timeout, [=] () {
+        rebuildIndex();
+    });
+
+    QObject::connect(source, &QAbstractItemModel::rowsInserted, [=] () { sourceChanged(); });
+    QObject::connect(source, &QAbstractItemModel::rowsRemoved,  [=] () { sourceChanged(); });
+    QObject::connect(source, &QAbstractItemModel::dataChanged,  [=] () { sourceChanged(); });
+    QObject::connect(source, &QAbstractItemModel::modelReset,   [=] () { sourceChanged(); });
+
+    QObject::connect(&buildWatcher, &QFutureWatcherBase::finished, [=] () {
+        index        = buildWatcher.result();
+        indexVersion = buildingVersion;
+
+        if (buildPending) {
+            buildPending = false;
+            rebuildIndex();
+        }
+
+        if (!query.isEmpty())
+            runSearch();
+    });
+
+    QObject::connect(&searchWatcher, &QFutureWatcherBase::finished, [=] () {
+        if (searchPending) {
+            searchPending = false;
+            runSearch();
+            return;
+        }
+
+        // The search box was cleared in the meantime
+        if (query.isEmpty())
+            return;
+
+        // The history changed since the index was built, so the slots may belong to other txs
+        // by now. The index is being rebuilt, and it searches again when it's done.
+        auto result = searchWatcher.result();
+        if (result.dataVersion != txModel->getDataVersion())
+            return;
+
+        // The matches can be anywhere in the history, so show all of it while searching
+        if (rowsBeforeSearch < 0)
+            rowsBeforeSearch = txModel->rowCount(QModelIndex());
+        txModel->fetchAll();
+
+        matches   = result.slots;
+        filtering = true;
+        invalidateFilter();
+    });
+}
+
+void TxFilterProxyModel::setSearchText(const QString& text) {
+    query = TxSearchQuery::parse(text);
+
+    if (query.isEmpty()) {
+        filtering = false;
+        matches.clear();
+        invalidateFilter();
+
+        // And page the table again from where it was
+        if (rowsBeforeSearch >= 0) {
+            txModel->limitRows(rowsBeforeSearch);
+            rowsBeforeSearch = -1;
+        }
+        return;
+    }
+
+    // Search with the index we have, and again once it's up to date
+    if (index == nullptr || indexVersion != txModel->getDataVersion())
+        rebuildIndex();
+
+    runSearch();
+}
+
+// The history changed, so the index needs to be rebuilt. It's only kept up to date while 
+// there's something in the search box.
+void TxFilterProxyModel::sourceChanged() {
+    if (!query.isEmpty() && indexVersion != txModel->getDataVersion())
+        rebuildTimer->start(rebuildDelay);
+}
+
+void TxFilterProxyModel::rebuildIndex() {
+    if (buildWatcher.isRunning()) {
+        buildPending = true;
+        return;
+    }
+
+    // The store and the row ids are implicitly shared, so these copies are cheap, and the 
+    // worker thread gets a view that doesn't change under it
+    TxStore      store  = txModel->getStoreCopy();
+    QVector<int> rowIds = txModel->getRowIds();
+    buildingVersion     = txModel->getDataVersion();
+
+    auto version        = buildingVersion;
+
+    buildWatcher.setFuture(QtConcurrent::run([=] () {
+        return std::make_shared<const TxSearchIndex>(store, rowIds, version);
+    }));
+}
+
+void TxFilterProxyModel::runSearch() {
+    // It will run when the index is ready
+    if (index == nullptr)
+        return;
+
+    if (searchWatcher.isRunning()) {
+        searchPending = true;
+        return;
+    }
+
+    auto searchIndex = index;
+    auto searchQuery = query;
+    searchWatcher.setFuture(QtConcurrent::run([=] () {
+        return searchIndex->search(searchQuery);
+    }));
+}
+
+bool TxFilterProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex&) const {
+    if (!filtering)
+        return true;
+
+    int slot = txModel->getSlot(sourceRow);
+    return slot < matches.size() && matches.testBit(slot);
+}
@@ -0,0 +1,114 @@
+#ifndef TXSEARCH_H
+#define TXSEARCH_H
+
+#include "precompiled.h"
+#include "txstore.h"
+
+class TxTableModel;
+
+// A parsed search box query. Every word has to match the start of the txid, the address or a 
+// word in the memo. "amount:" and "date:" take a range like "1..5" or "2020-01-01..2020-01-31",
+// either end of which can be left out. Amounts are compared without their sign.
+struct TxSearchQuery {
+    QStringList terms;
+
+    bool        hasAmount   = false;
+    qint64      minAmount   = 0;        // zatoshis
+    qint64      maxAmount   = 0;
+
+    bool        hasDate     = false;
+    qint64      fromTime    = 0;        // secs since epoch
+    qint64      toTime      = 0;
+
+    static TxSearchQuery parse(const QString& text);
+
+    bool isEmpty() const { return terms.isEmpty() && !hasAmount && !hasDate; }
+};
+
+// The rows that matched a search, as a bit for each store slot. The model reuses slots as txs 
+// come and go, so the bits only apply to the history version the index was built from.
+struct TxSearchResult {
+    quint64     dataVersion = 0;
+    QBitArray   slots;
+};
+
+/**
+ * Search index over the transaction history. It's built from a copy of the TxStore, so it can 
+ * be built and searched on a worker thread while the model carries on changing.
+ */
+class TxSearchIndex {
+public:
+    TxSearchIndex(const TxStore& store, const QVector<int>& rowIds, quint64 dataVersion);
+
+    TxSearchResult search(const TxSearchQuery& query) const;
+
+private:
+    struct Term {
+        QString text;
+        int     rowId;
+
+        bool operator<(const Term& o) const { return text < o.text; }
+    };
+
+    struct Entry {
+        qint64  amount;
+        qint64  datetime;
+    };
+
+    QSet<int> searchIds(const TxSearchQuery& query) const;
+
+    static void addPrefixMatches(const QVector<Term>& terms, const QString& prefix, QSet<int>& out);
+    static bool isInRange(const Entry& e, const TxSearchQuery& query);
+
+    QVector<Term>       txids;
+    QVector<Term>       addresses;
+    QVector<Term>       memoWords;
+    QHash<int, Entry>   entries;
+    int                 maxSlot     = -1;
+    quint64             dataVersion = 0;
+};
+
+/**
+ * Filters the transactions table by the search box. The index is rebuilt in the background 
+ * when the history changes, and queries run in the background as well, so typing in the search 
+ * box never waits for them.
+ */
+class TxFilterProxyModel : public QSortFilterProxyModel {
+public:
+    TxFilterProxyModel(TxTableModel* source, QObject* parent);
+
+    void setSearchText(const QString& text);
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const;
+
+private:
+    void sourceChanged();
+    void rebuildIndex();
+    void runSearch();
+
+    TxTableModel*                                           txModel;
+
+    std::shared_ptr<const TxSearchIndex>                    index;
+    quint64                                                 indexVersion    = 0;
+    quint64                                                 buildingVersion = 0;
+    QFutureWatcher<std::shared_ptr<const TxSearchIndex>>    buildWatcher;
+    bool                                                    buildPending    = false;
+    QTimer*                                                 rebuildTimer    = nullptr;
+
+    TxSearchQuery                                           query;
+    QFutureWatcher<TxSearchResult>                          searchWatcher;
+    bool                                                    searchPending   = false;
+
+    bool                                                    filtering       = false;
+    QBitArray                                               matches;        // By store slot
+
+    // How many rows the table showed before the search showed all of them, so it can go back
+    // to that when the search is cleared
+    int                                                     rowsBeforeSearch = -1;
+
+    // Wait this long after the history changes before rebuilding the index
+    static const int                                        rebuildDelay    = 1000;
+};
+
+#endif // TXSEARCH_H
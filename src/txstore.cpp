@@ -0,0 +1,134 @@
+#include "txstore.h"
+#include "rpc.h"
+
+int TxStore::add(const TransactionItem& tx) {
+    int slot;
+    if (!freeSlots.isEmpty()) {
+        slot = freeSlots.takeLast();
+    } else {
+        slot = records.size();
+        records.append(Record());
+    }
+
+    fill(records[slot], slot, tx);
+    return slot;
+}
+
+void TxStore::set(int slot, const TransactionItem& tx) {
+    fill(records[slot], slot, tx);
+}
+
+void TxStore::remove(int slot) {
+    memos.remove(slot);
+    records[slot].flags = 0;
+    freeSlots.append(slot);
+}
+
+void TxStore::clear() {
+    records.clear();
+    freeSlots.clear();
+    strings.clear();
+    stringIds.clear();
+    memos.clear();
+}
+
+quint32 TxStore::intern(const QString& s) {
+    auto it = stringIds.constFind(s);
+    if (it != stringIds.constEnd())
+        return it.value();
+
+    quint32 id = strings.size();
+    strings.append(s);
+    stringIds.insert(s, id);
+    return id;
+}
+
+static bool isHexTxid(const QString& txid) {
+    if (txid.length() != 64)
+        return false;
+
+    for (const auto& c : txid) {
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')))
+            return false;
+    }
+
+    return true;
+}
+
+void TxStore::fill(Record& r, int slot, const TransactionItem& tx) {
+    r.flags = 0;
+
+    if (isHexTxid(tx.txid)) {
+        auto bytes = QByteArray::fromHex(tx.txid.toLatin1());
+        memcpy(r.txid, bytes.constData(), sizeof(r.txid));
+    } else {
+        quint32 id = intern(tx.txid);
+        memset(r.txid, 0, sizeof(r.txid));
+        memcpy(r.txid, &id, sizeof(id));
+        r.flags |= TxidInterned;
+    }
+
+    r.datetime      = tx.datetime;
+    r.amount        = tx.amount.toqint64();
+    r.confirmations = (qint32) tx.confirmations;
+    r.address       = intern(tx.address);
+    r.fromAddr      = intern(tx.fromAddr);
+    r.type          = (quint16) intern(tx.type);
+
+    if (tx.memo.isEmpty()) {
+        memos.remove(slot);
+    } else {
+        memos.insert(slot, tx.memo);
+        r.flags |= HasMemo;
+    }
+}
+
+QByteArray TxStore::key(int source, const TransactionItem& tx) {
+    quint32 ids[] = { intern(tx.type), intern(tx.address) };
+
+    QByteArray k;
+    k.reserve(1 + 32 + sizeof(ids));
+    k.append((char) source);
+    if (isHexTxid(tx.txid))
+        k.append(QByteArray::fromHex(tx.txid.toLatin1()));
+    else
+        k.append(tx.txid.toUtf8()).append('\0');
+    k.append(reinterpret_cast<const char*>(ids), sizeof(ids));
+
+    return k;
+}
+
+QString TxStore::txid(int slot) const {
+    const auto& r = records.at(slot);
+    if (r.flags & TxidInterned) {
+        quint32 id;
+        memcpy(&id, r.txid, sizeof(id));
+        return strings.at(id);
+    }
+
+    return QString::fromLatin1(QByteArray::fromRawData(reinterpret_cast<const char*>(r.txid), sizeof(r.txid)).toHex());
+}
+
+const QString& TxStore::memo(int slot) const {
+    static const QString empty;
+    if (!(records.at(slot).flags & HasMemo))
+        return empty;
+
+    auto it = memos.constFind(slot);
+    return it == memos.constEnd() ? empty : it.value();
+}
+
+bool TxStore::isSame(int slot, const TransactionItem& tx, bool ignoreConfirmations) const {
+    const auto& r = records.at(slot);
+    return r.datetime == tx.datetime && 
+           r.amount == tx.amount.toqint64() &&
+           (ignoreConfirmations || r.confirmations == tx.confirmations) &&
+           type(slot) == tx.type && address(slot) == tx.address &&
+           fromAddr(slot) == tx.fromAddr && memo(slot) == tx.memo &&
+           txid(slot).compare(tx.txid, Qt::CaseInsensitive) == 0;
+}
+
+TransactionItem TxStore::item(int slot) const {
+    return TransactionItem{ type(slot), datetime(slot), address(slot), txid(slot), amount(slot), 
+                            confirmations(slot), fromAddr(slot), memo(slot) };
+}
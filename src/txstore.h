@@ -0,0 +1,71 @@
+#ifndef TXSTORE_H
+#define TXSTORE_H
+
+#include "precompiled.h"
+#include "camount.h"
+
+struct TransactionItem;
+
+/**
+ * Compact storage for the transaction history. Each tx is kept in a fixed size slot, with the
+ * txid as 32 raw bytes, the addresses and types interned into a string table, the amount in 
+ * zatoshis and the memo (which most txs don't have) kept out of line. 
+ * 
+ * Slots are stable for as long as the tx is in the store, and are reused after it is removed.
+ */
+class TxStore {
+public:
+    TxStore() = default;
+
+    int             add(const TransactionItem& tx);
+    void            set(int slot, const TransactionItem& tx);
+    void            remove(int slot);
+    void            clear();
+
+    // A key that identifies a tx by its txid, type and address, for the given source
+    QByteArray      key(int source, const TransactionItem& tx);
+
+    bool            isSame(int slot, const TransactionItem& tx, bool ignoreConfirmations = false) const;
+    TransactionItem item(int slot) const;
+
+    // Views into a slot. The strings are shared with the store, so none of these copy.
+    QString         txid(int slot) const;
+    const QString&  type(int slot) const          { return strings.at(records.at(slot).type); }
+    const QString&  address(int slot) const       { return strings.at(records.at(slot).address); }
+    const QString&  fromAddr(int slot) const      { return strings.at(records.at(slot).fromAddr); }
+    const QString&  memo(int slot) const;
+    qint64          datetime(int slot) const      { return records.at(slot).datetime; }
+    qint64          confirmations(int slot) const { return records.at(slot).confirmations; }
+    CAmount         amount(int slot) const        { return CAmount::fromqint64(records.at(slot).amount); }
+
+private:
+    struct Record {
+        quint8      txid[32];
+        qint64      datetime;
+        qint64      amount;         // zatoshis
+        qint32      confirmations;
+        quint32     address;        // Into strings
+        quint32     fromAddr;       // Into strings
+        quint16     type;           // Into strings
+        quint8      flags;
+    };
+
+    enum Flags {
+        HasMemo         = 0x01,
+        // The txid isn't 64 hex chars, so it's interned and its string id is in the txid bytes
+        TxidInterned    = 0x02
+    };
+
+    quint32         intern(const QString& s);
+    void            fill(Record& r, int slot, const TransactionItem& tx);
+
+    QVector<Record>             records;
+    QVector<int>                freeSlots;
+
+    QVector<QString>            strings;
+    QHash<QString, quint32>     stringIds;
+
+    QHash<int, QString>         memos;
+};
+
+#endif // TXSTORE_H
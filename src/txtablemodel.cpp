@@ -1,42 +1,272 @@
 #include "txtablemodel.h"
 #include "settings.h"
 #include "rpc.h"
+#include "trace.h"
 
 TxTableModel::TxTableModel(QObject *parent)
      : QAbstractTableModel(parent) {
     headers << QObject::tr("Type") << QObject::tr("Address") << QObject::tr("Date/Time") << QObject::tr("Confirmations") << QObject::tr("Amount");
+
+    // The decorations are the same for every row, so they are only made once
+    paymentRequestPixmap = QIcon(":/icons/res/paymentreq.gif").pixmap(16, 16);
+    memoPixmap           = QApplication::style()->standardIcon(QStyle::SP_MessageBoxInformation).pixmap(16, 16);
+
+    // Empty pixmap to make it align
+    emptyPixmap          = QPixmap(16, 16);
+    emptyPixmap.fill(Qt::transparent);
+
+    // Watch the table for locale changes, since the dates are formatted for the locale
+    if (parent != nullptr)
+        parent->installEventFilter(this);
+
+    // And its viewport for the first paint, to measure how long the history takes to show up
+    sinceCreated.start();
+    auto view = qobject_cast<QAbstractScrollArea*>(parent);
+    if (view != nullptr) {
+        viewport = view->viewport();
+        viewport->installEventFilter(this);
+    }
 }
 
 TxTableModel::~TxTableModel() {
     delete modeldata;
-    delete tTrans;
-    delete zsTrans;
-    delete zrTrans;
+    delete store;
+    delete slotsByKey;
 }
 
 void TxTableModel::addZSentData(const QList<TransactionItem>& data) {
-    delete zsTrans;
-    zsTrans = new QList<TransactionItem>();
-    std::copy(data.begin(), data.end(), std::back_inserter(*zsTrans));
-
-    updateAllData();
+    applyData(Source::ZSentSource, data);
+    setFresh(Source::ZSentSource);
 }
 
 void TxTableModel::addZRecvData(const QList<TransactionItem>& data) {
-    delete zrTrans;
-    zrTrans = new QList<TransactionItem>();
-    std::copy(data.begin(), data.end(), std::back_inserter(*zrTrans));
-
-    updateAllData();
+    applyData(Source::ZRecvSource, data);
+    setFresh(Source::ZRecvSource);
 }
 
 
 void TxTableModel::addTData(const QList<TransactionItem>& data) {
-    delete tTrans;
-    tTrans = new QList<TransactionItem>();
-    std::copy(data.begin(), data.end(), std::back_inserter(*tTrans));
+    applyData(Source::TSource, data);
+    setFresh(Source::TSource);
+}
+
+void TxTableModel::addCachedData(const QList<TransactionItem>& tData, const QList<TransactionItem>& zSentData,
+                                 const QList<TransactionItem>& zRecvData) {
+    applyData(Source::TSource,     tData);
+    applyData(Source::ZSentSource, zSentData);
+    applyData(Source::ZRecvSource, zRecvData);
 
-    updateAllData();
+    staleSources = (1 << NumSources) - 1;
+    if (exposedRows > 0)
+        dataChanged(index(0, 0), index(exposedRows - 1, columnCount(index(0,0))-1), { Qt::ForegroundRole });
+}
+
+// The source has live data now. Once all of them do, the rows are shown normally again.
+void TxTableModel::setFresh(Source source) {
+    if (!isStale())
+        return;
+
+    staleSources &= ~(1 << source);
+    if (!isStale() && exposedRows > 0)
+        dataChanged(index(0, 0), index(exposedRows - 1, columnCount(index(0,0))-1), { Qt::ForegroundRole });
+}
+
+QList<TransactionItem> TxTableModel::getSourceData(Source source) const {
+    QList<TransactionItem> txs;
+    if (slotsByKey == nullptr)
+        return txs;
+
+    txs.reserve(sourceKeys[source].size());
+    for (const auto& key : sourceKeys[source]) {
+        txs.push_back(store->item(slotsByKey->value(key)));
+    }
+
+    return txs;
+}
+
+/**
+ * Replace all the rows from the given source with the new data. Only the rows that were 
+ * actually added, removed or changed are updated in the view, so the scroll position and 
+ * the selection are kept.
+ */
+void TxTableModel::applyData(Source source, const QList<TransactionItem>& data) {
+    if (modeldata == nullptr) {
+        modeldata  = new QVector<int>();
+        store      = new TxStore();
+        slotsByKey = new QHash<QByteArray, int>();
+    }
+
+    // Key each tx by where it came from and what it is. The same txid can show up several
+    // times (eg. once per address), so the duplicates are numbered.
+    QHash<QByteArray, const TransactionItem*> incoming;
+    for (const auto& tx : data) {
+        QByteArray base = store->key(source, tx);
+        QByteArray key  = base;
+        for (quint32 n = 1; incoming.contains(key); n++) {
+            key = base + QByteArray(reinterpret_cast<const char*>(&n), sizeof(n));
+        }
+
+        incoming.insert(key, &tx);
+    }
+
+    QList<QByteArray> removed;
+    for (const auto& key : sourceKeys[source]) {
+        if (!incoming.contains(key))
+            removed.append(key);
+    }
+
+    int added = 0;
+    for (auto it = incoming.constBegin(); it != incoming.constEnd(); it++) {
+        if (!slotsByKey->contains(it.key()))
+            added++;
+    }
+
+    sourceKeys[source].clear();
+    for (auto it = incoming.constBegin(); it != incoming.constEnd(); it++) {
+        sourceKeys[source].insert(it.key());
+    }
+
+    // Big changes, like the first load, are much cheaper as a single reset
+    if (removed.size() + added > maxIncrementalChanges) {
+        for (const auto& key : removed) {
+            store->remove(slotsByKey->take(key));
+        }
+        for (auto it = incoming.constBegin(); it != incoming.constEnd(); it++) {
+            auto slot = slotsByKey->constFind(it.key());
+            if (slot != slotsByKey->constEnd())
+                store->set(slot.value(), *it.value());
+            else
+                slotsByKey->insert(it.key(), store->add(*it.value()));
+        }
+
+        resetAllData();
+        return;
+    }
+
+    for (const auto& key : removed) {
+        removeTxRow(key);
+    }
+
+    for (auto it = incoming.constBegin(); it != incoming.constEnd(); it++) {
+        const auto& key = it.key();
+        const auto& tx  = *it.value();
+
+        auto found = slotsByKey->constFind(key);
+        if (found == slotsByKey->constEnd()) {
+            insertTxRow(key, tx);
+            continue;
+        }
+
+        int slot = found.value();
+        if (store->datetime(slot) != tx.datetime) {
+            // It needs to move to a different position
+            removeTxRow(key);
+            insertTxRow(key, tx);
+        } else if (!store->isSame(slot, tx)) {
+            int row = lowerBound(tx.datetime, slot);
+            if (!store->isSame(slot, tx, true))
+                historyVersion++;
+
+            store->set(slot, tx);
+            displayCache.remove(slot);
+            dataVersion++;
+
+            if (row < exposedRows)
+                dataChanged(index(row, 0), index(row, columnCount(index(0,0))-1));
+        }
+    }
+}
+
+// Rebuild the row order from scratch
+void TxTableModel::resetAllData() {
+    beginResetModel();
+
+    dataVersion++;
+    historyVersion++;
+    modeldata->clear();
+    displayCache.clear();
+
+    modeldata->reserve(slotsByKey->size());
+    for (auto slot : *slotsByKey) {
+        modeldata->append(slot);
+    }
+
+    std::sort(modeldata->begin(), modeldata->end(), [=] (int a, int b) {
+        auto ta = store->datetime(a);
+        auto tb = store->datetime(b);
+        return ta > tb || (ta == tb && a < b); // reverse sort
+    });
+
+    // Keep showing as many rows as before, so the view doesn't jump back to the top
+    exposedRows = qMin(modeldata->size(), qMax(exposedRows, (int)fetchPageSize));
+
+    endResetModel();
+}
+
+// Index of the first row that doesn't sort before a tx with this datetime in this slot
+int TxTableModel::lowerBound(qint64 datetime, int slot) const {
+    int lo = 0;
+    int hi = modeldata->size();
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        int s   = modeldata->at(mid);
+        auto t  = store->datetime(s);
+        if (t > datetime || (t == datetime && s < slot))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+void TxTableModel::insertTxRow(const QByteArray& key, const TransactionItem& tx) {
+    int slot = store->add(tx);
+    int row  = lowerBound(tx.datetime, slot);
+    dataVersion++;
+    historyVersion++;
+
+    // Rows past the ones the view has fetched are added quietly, and shown when it fetches more.
+    // If the view already has all the rows, it gets the new one too.
+    if (row >= exposedRows && exposedRows < modeldata->size()) {
+        modeldata->insert(row, slot);
+        slotsByKey->insert(key, slot);
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), row, row);
+    modeldata->insert(row, slot);
+    slotsByKey->insert(key, slot);
+    exposedRows++;
+    endInsertRows();
+}
+
+void TxTableModel::removeTxRow(const QByteArray& key) {
+    auto found = slotsByKey->constFind(key);
+    if (found == slotsByKey->constEnd())
+        return;
+
+    int slot = found.value();
+    int row  = lowerBound(store->datetime(slot), slot);
+    if (row >= modeldata->size() || modeldata->at(row) != slot)
+        return;
+
+    dataVersion++;
+    historyVersion++;
+
+    bool exposed = row < exposedRows;
+    if (exposed)
+        beginRemoveRows(QModelIndex(), row, row);
+
+    modeldata->remove(row);
+    slotsByKey->remove(key);
+    store->remove(slot);
+    displayCache.remove(slot);
+
+    if (exposed) {
+        exposedRows--;
+        endRemoveRows();
+    }
 }
 
 bool TxTableModel::exportToCsv(QString fileName) const {
@@ -56,13 +286,13 @@ bool TxTableModel::exportToCsv(QString fileName) const {
     out << "\"Memo\"";
     out << endl;
     
-    // Write out each row
+    // Write out each row, including the ones the view hasn't fetched yet
     for (int row = 0; row < modeldata->length(); row++) {
         for (int col = 0; col < headers.length(); col++) {
-            out << "\"" << data(index(row, col), Qt::DisplayRole).toString() << "\",";
+            out << "\"" << displayText(row, col) << "\",";
         }
         // Memo
-        out << "\"" << modeldata->at(row).memo << "\"";
+        out << "\"" << store->memo(modeldata->at(row)) << "\"";
         out << endl;
     }
 
@@ -70,30 +300,45 @@ bool TxTableModel::exportToCsv(QString fileName) const {
     return true;
 }
 
-void TxTableModel::updateAllData() {    
-    auto newmodeldata = new QList<TransactionItem>();
+ int TxTableModel::rowCount(const QModelIndex&) const
+ {
+    if (modeldata == nullptr) return 0;
+    return exposedRows;
+ }
 
-    if (tTrans  != nullptr) std::copy( tTrans->begin(),  tTrans->end(), std::back_inserter(*newmodeldata));
-    if (zsTrans != nullptr) std::copy(zsTrans->begin(), zsTrans->end(), std::back_inserter(*newmodeldata));
-    if (zrTrans != nullptr) std::copy(zrTrans->begin(), zrTrans->end(), std::back_inserter(*newmodeldata));
+ bool TxTableModel::canFetchMore(const QModelIndex& parent) const
+ {
+    if (parent.isValid() || modeldata == nullptr) return false;
+    return exposedRows < modeldata->size();
+ }
 
-    // Sort by reverse time
-    std::sort(newmodeldata->begin(), newmodeldata->end(), [=] (auto a, auto b) {
-        return a.datetime > b.datetime; // reverse sort
-    });
+ void TxTableModel::fetchMore(const QModelIndex& parent)
+ {
+    if (!canFetchMore(parent)) return;
 
-    // And then swap out the modeldata with the new one.
-    delete modeldata;
-    modeldata = newmodeldata;
+    int more = qMin((int)fetchPageSize, modeldata->size() - exposedRows);
+    beginInsertRows(QModelIndex(), exposedRows, exposedRows + more - 1);
+    exposedRows += more;
+    endInsertRows();
+ }
 
-    dataChanged(index(0, 0), index(modeldata->size()-1, columnCount(index(0,0))-1));
-    layoutChanged();
-}
+ void TxTableModel::fetchAll()
+ {
+    if (!canFetchMore(QModelIndex())) return;
 
- int TxTableModel::rowCount(const QModelIndex&) const
+    beginInsertRows(QModelIndex(), exposedRows, modeldata->size() - 1);
+    exposedRows = modeldata->size();
+    endInsertRows();
+ }
+
+ void TxTableModel::limitRows(int rows)
  {
-    if (modeldata == nullptr) return 0;
-    return modeldata->size();
+    rows = qMax(rows, (int)fetchPageSize);
+    if (exposedRows <= rows) return;
+
+    beginRemoveRows(QModelIndex(), rows, exposedRows - 1);
+    exposedRows = rows;
+    endRemoveRows();
  }
 
  int TxTableModel::columnCount(const QModelIndex&) const
@@ -102,6 +347,69 @@ void TxTableModel::updateAllData() {
  }
 
 
+ void TxTableModel::invalidateDisplayCache() {
+    displayCache.clear();
+
+    if (rowCount(QModelIndex()) > 0)
+        dataChanged(index(0, 0), index(rowCount(QModelIndex())-1, columnCount(index(0,0))-1));
+ }
+
+ bool TxTableModel::eventFilter(QObject* object, QEvent* event) {
+    if (event->type() == QEvent::LocaleChange)
+        invalidateDisplayCache();
+
+    if (event->type() == QEvent::Paint && object == viewport && exposedRows > 0 && !firstRowsPainted) {
+        firstRowsPainted = true;
+        TRACE_INFO(traceUi) << "Transactions table first painted" << sinceCreated.elapsed() << "ms after startup, with" 
+                            << exposedRows << "of" << modeldata->size() << "rows exposed";
+    }
+
+    return QAbstractTableModel::eventFilter(object, event);
+ }
+
+ const TxTableModel::DisplayStrings& TxTableModel::displayStrings(int row) const {
+    double price = Settings::getInstance()->getZECPrice();
+    if (price != displayCachePrice) {
+        displayCache.clear();
+        displayCachePrice = price;
+    }
+
+    int slot = modeldata->at(row);
+    auto it = displayCache.find(slot);
+    if (it != displayCache.end())
+        return it.value();
+
+    const auto& address = store->address(slot);
+    const auto& memo    = store->memo(slot);
+    CAmount     amount  = store->amount(slot);
+
+    DisplayStrings d;
+    d.address   = address.trimmed().isEmpty() ? "(Shielded)" : address;
+    d.time      = QDateTime::fromMSecsSinceEpoch(store->datetime(slot) * (qint64)1000).toLocalTime().toString();
+    d.amount    = Settings::getDisplayFormat(amount);
+    d.usdAmount = Settings::getUSDFormat(amount);
+
+    if (memo.startsWith("safecoin:")) {
+        d.typeTip = Settings::paymentURIPretty(Settings::parseURI(memo));
+    } else {
+        d.typeTip = store->type(slot) + 
+            (memo.isEmpty() ? "" : " tx memo: \"" + memo.toHtmlEscaped() + "\"");
+    }
+
+    return displayCache.insert(slot, d).value();
+ }
+
+ QString TxTableModel::displayText(int row, int column) const {
+    switch (column) {
+    case Column::Type: return store->type(modeldata->at(row));
+    case Column::Address: return displayStrings(row).address;
+    case 2: return displayStrings(row).time;
+    case 3: return displayStrings(row).amount;
+    }
+
+    return QString();
+ }
+
  QVariant TxTableModel::data(const QModelIndex &index, int role) const
  {
      // Align numeric columns (confirmations, amount) right
@@ -109,75 +417,49 @@ void TxTableModel::updateAllData() {
          (index.column() == Column::Confirmations || index.column() == Column::Amount))
         return QVariant(Qt::AlignRight | Qt::AlignVCenter);
 
-    auto dat = modeldata->at(index.row());
+    int slot = modeldata->at(index.row());
     if (role == Qt::ForegroundRole) {
-        if (dat.confirmations <= 0) {
-            QBrush b;
-            b.setColor(Qt::red);
-            return b;
-        }
+        static const QBrush unconfirmed = [] { QBrush b; b.setColor(Qt::red);   return b; }();
+        static const QBrush confirmed   = [] { QBrush b; b.setColor(Qt::black); return b; }();
+        static const QBrush stale       = [] { QBrush b; b.setColor(Qt::gray);  return b; }();
+
+        if (isStale())
+            return stale;
 
-        // Else, just return the default brush
-        QBrush b;
-        b.setColor(Qt::black);
-        return b;        
+        return store->confirmations(slot) <= 0 ? unconfirmed : confirmed;
     }
 
     if (role == Qt::DisplayRole) {
         switch (index.column()) {
-        case Column::Type: return dat.type;
-        case Column::Address: {
-                    auto addr = dat.address;
-                    if (addr.trimmed().isEmpty()) 
-                        return "(Shielded)";
-                    else 
-                        return addr;
-                }
-        case 2: return QDateTime::fromMSecsSinceEpoch(modeldata->at(index.row()).datetime *  (qint64)1000).toLocalTime().toString();
-        case 3: return Settings::getDisplayFormat(modeldata->at(index.row()).amount);
+        case Column::Type: 
+        case Column::Address: 
+        case 2: 
+        case 3: return displayText(index.row(), index.column());
         }
     } 
 
     if (role == Qt::ToolTipRole) {
         switch (index.column()) {
-        case Column::Type: {
-                    if (dat.memo.startsWith("safecoin:")) {
-                        return Settings::paymentURIPretty(Settings::parseURI(dat.memo));
-                    } else {
-                        return modeldata->at(index.row()).type + 
-                        (dat.memo.isEmpty() ? "" : " tx memo: \"" + dat.memo.toHtmlEscaped() + "\"");
-                    }
-                }
-        case Column::Address: {
-                    auto addr = modeldata->at(index.row()).address;
-                    if (addr.trimmed().isEmpty()) 
-                        return "(Shielded)";
-                    else 
-                        return addr;
-                }
-        case Column::Time: return QDateTime::fromMSecsSinceEpoch(modeldata->at(index.row()).datetime * (qint64)1000).toLocalTime().toString();
-        case Column::Confirmations: return QString("%1 Network Confirmations").arg(QString::number(dat.confirmations));
-        case Column::Amount: return Settings::getInstance()->getUSDFormat(modeldata->at(index.row()).amount);
+        case Column::Type: return displayStrings(index.row()).typeTip;
+        case Column::Address: return displayStrings(index.row()).address;
+        case Column::Time: return displayStrings(index.row()).time;
+        case Column::Confirmations: return QString("%1 Network Confirmations").arg(QString::number(store->confirmations(slot)));
+        case Column::Amount: return displayStrings(index.row()).usdAmount;
         }    
     }
 
     if (role == Qt::DecorationRole && index.column() == 0) {
-        if (!dat.memo.isEmpty()) {
+        const auto& memo = store->memo(slot);
+        if (!memo.isEmpty()) {
             // If the memo is a Payment URI, then show a payment request icon
-            if (dat.memo.startsWith("safecoin:")) {
-                QIcon icon(":/icons/res/paymentreq.gif");
-                return QVariant(icon.pixmap(16, 16));
+            if (memo.startsWith("safecoin:")) {
+                return QVariant(paymentRequestPixmap);
             } else {
                 // Return the info pixmap to indicate memo
-                QIcon icon = QApplication::style()->standardIcon(QStyle::SP_MessageBoxInformation);            
-                return QVariant(icon.pixmap(16, 16));
-                }
+                return QVariant(memoPixmap);
+            }
         } else {
-            // Empty pixmap to make it align
-            QPixmap p(16, 16);
-            //p.fill(Qt::white);
-            p.fill(Qt::transparent);
-            return QVariant(p);
+            return QVariant(emptyPixmap);
         }
     }
 
@@ -204,29 +486,29 @@ void TxTableModel::updateAllData() {
  }
 
 QString TxTableModel::getTxId(int row) const {
-    return modeldata->at(row).txid;
+    return store->txid(modeldata->at(row));
 }
 
 QString TxTableModel::getMemo(int row) const {
-    return modeldata->at(row).memo;
+    return store->memo(modeldata->at(row));
 }
 
 qint64 TxTableModel::getConfirmations(int row) const {
-    return modeldata->at(row).confirmations;
+    return store->confirmations(modeldata->at(row));
 }
 
 QString TxTableModel::getAddr(int row) const {
-    return modeldata->at(row).address.trimmed();
+    return store->address(modeldata->at(row)).trimmed();
 }
 
 qint64 TxTableModel::getDate(int row) const {
-    return modeldata->at(row).datetime;
+    return store->datetime(modeldata->at(row));
 }
 
 QString TxTableModel::getType(int row) const {
-    return modeldata->at(row).type;
+    return store->type(modeldata->at(row));
 }
 
 QString TxTableModel::getAmt(int row) const {
-    return Settings::getDecimalString(modeldata->at(row).amount);
+    return Settings::getDecimalString(store->amount(modeldata->at(row)));
 }
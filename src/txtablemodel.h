@@ -2,6 +2,7 @@
 #define STRINGSTABLEMODEL_H
 
 #include "precompiled.h"
+#include "txstore.h"
 
 struct TransactionItem;
 
@@ -20,10 +21,27 @@ public:
         Amount = 4
     };
 
+    // Where the rows came from. Each source replaces all of its rows when new data comes in.
+    enum Source {
+        TSource = 0,
+        ZSentSource,
+        ZRecvSource,
+        NumSources
+    };
+
     void addTData    (const QList<TransactionItem>& data);
     void addZSentData(const QList<TransactionItem>& data);
     void addZRecvData(const QList<TransactionItem>& data);     
 
+    // Show the saved history until the sources report in. Until each of them has, the rows 
+    // are greyed out.
+    void addCachedData(const QList<TransactionItem>& tData, const QList<TransactionItem>& zSentData,
+                       const QList<TransactionItem>& zRecvData);
+    bool isStale() const                { return staleSources != 0; }
+
+    // All the txs from a source
+    QList<TransactionItem> getSourceData(Source source) const;
+
     QString  getTxId(int row) const;
     QString  getMemo(int row) const;
     QString  getAddr(int row) const;
@@ -32,21 +50,95 @@ public:
     qint64   getConfirmations(int row) const;
     QString  getAmt (int row) const;
 
+    // Copies of the history for the search index. Both are implicitly shared, so they're cheap.
+    TxStore       getStoreCopy() const  { return *store; }
+    QVector<int>  getRowIds() const     { return *modeldata; }
+    // The store slot of a row, which is what the search index matches on
+    int           getSlot(int row) const { return modeldata->at(row); }
+
+    // Goes up every time the history changes
+    quint64  getDataVersion() const     { return dataVersion; }
+    // Same, but not when only the confirmations of txs change, which they do every block
+    quint64  getHistoryVersion() const  { return historyVersion; }
+
+    // Expose all the rows to the view at once
+    void     fetchAll();
+    // Go back to exposing only the first rows (at least a page), eg. after fetchAll
+    void     limitRows(int rows);
+
     bool     exportToCsv(QString fileName) const;
 
     int      rowCount(const QModelIndex &parent) const;
+    bool     canFetchMore(const QModelIndex &parent) const;
+    void     fetchMore(const QModelIndex &parent);
     int      columnCount(const QModelIndex &parent) const;
     QVariant data(const QModelIndex &index, int role) const;
     QVariant headerData(int section, Qt::Orientation orientation, int role) const;
 
+    // Drop the cached display strings, eg. after the locale changes
+    void     invalidateDisplayCache();
+
+    bool     eventFilter(QObject* object, QEvent* event);
+
 private:
-    void updateAllData();
+    void applyData(Source source, const QList<TransactionItem>& data);
+    void setFresh(Source source);
+    void resetAllData();
+
+    int  lowerBound(qint64 datetime, int slot) const;
+    void insertTxRow(const QByteArray& key, const TransactionItem& tx);
+    void removeTxRow(const QByteArray& key);
+
+    // The txs, and the store slot of each row, sorted by reverse time (and then by slot)
+    TxStore*                            store        = nullptr;
+    QVector<int>*                       modeldata    = nullptr;
+
+    // The slot of each tx by key, and the keys of the rows from each source
+    QHash<QByteArray, int>*             slotsByKey   = nullptr;
+    QSet<QByteArray>                    sourceKeys[NumSources];
+
+    // When more rows than this change at once, reset the model instead of inserting and
+    // removing them one by one
+    static const int                    maxIncrementalChanges = 1000;
+
+    // Only the first exposedRows rows are shown to the view. More are exposed a page at a 
+    // time as the view scrolls down (see fetchMore), so the view never has to lay out the 
+    // whole history at once. The whole history is still fetched from safecoind and held in 
+    // the store: z_listreceivedbyaddress can't be paged, so the pages are only local.
+    int                                 exposedRows  = 0;
+    static const int                    fetchPageSize = 200;
+
+    quint64                             dataVersion  = 0;
+    quint64                             historyVersion = 0;
+
+    // Bit set for each source that still shows the saved history
+    int                                 staleSources = 0;
+
+    // The formatted strings for a row, built the first time the row is painted
+    struct DisplayStrings {
+        QString address;
+        QString time;
+        QString amount;
+        QString usdAmount;
+        QString typeTip;
+    };
+
+    const DisplayStrings& displayStrings(int row) const;
+    QString               displayText(int row, int column) const;
+
+    // Display strings by slot. The USD amounts depend on the price, so the cache is dropped
+    // whenever the price (or the currency) changes.
+    mutable QHash<int, DisplayStrings>     displayCache;
+    mutable double                         displayCachePrice = -1;
 
-    QList<TransactionItem>*  tTrans      = nullptr;
-    QList<TransactionItem>*  zrTrans     = nullptr;     // Z received
-    QList<TransactionItem>*  zsTrans     = nullptr;     // Z sent
+    // For measuring the time to the first paint of the history
+    QObject*                 viewport         = nullptr;
+    QElapsedTimer            sinceCreated;
+    bool                     firstRowsPainted = false;
 
-    QList<TransactionItem>* modeldata    = nullptr;
+    QPixmap                  paymentRequestPixmap;
+    QPixmap                  memoPixmap;
+    QPixmap                  emptyPixmap;
 
     QList<QString>           headers;
 };
@@ -0,0 +1,50 @@
+#ifndef WALLETSNAPSHOT_H
+#define WALLETSNAPSHOT_H
+
+#include "precompiled.h"
+#include "camount.h"
+
+struct UnspentOutput {
+    QString address;
+    QString txid;
+    CAmount amount;
+    int     confirmations;
+    bool    spendable;
+};
+
+/**
+ * The wallet's balances, UTXOs and addresses as of the last refresh. A published snapshot is 
+ * never modified. Each refresh builds the next one and swaps it in, so anyone holding on to a 
+ * snapshot always sees a consistent state. The Qt containers are implicitly shared, so making
+ * the next snapshot from the current one doesn't copy the parts that didn't change.
+ */
+struct WalletSnapshot {
+    // Goes up by one for every snapshot that's published
+    quint64                     version             = 0;
+
+    // The history cache was loaded at startup, and the balances haven't been refreshed from 
+    // safecoind yet. The cached values are kept apart from the live ones, and are only for 
+    // showing. Nothing that checks or builds a send reads them.
+    bool                        stale               = false;
+    CAmount                     cachedBalTransparent;
+    CAmount                     cachedBalShielded;
+    CAmount                     cachedBalTotal;
+    QMap<QString, CAmount>      cachedBalances;
+    QList<QString>              cachedZaddresses;
+    QList<QString>              cachedTaddresses;
+
+    bool                        balancesLoaded      = false;
+    CAmount                     balTransparent;
+    CAmount                     balShielded;
+    CAmount                     balTotal;
+    QMap<QString, CAmount>      balances;
+    QList<UnspentOutput>        utxos;
+    bool                        anyUnconfirmed      = false;
+
+    bool                        zaddressesLoaded    = false;
+    QList<QString>              zaddresses;
+    bool                        taddressesLoaded    = false;
+    QList<QString>              taddresses;
+};
+
+#endif // WALLETSNAPSHOT_H
@@ -8,6 +8,7 @@
 #include "settings.h"
 #include "ui_mobileappconnector.h"
 #include "version.h"
+#include "trace.h"
 
 // Wrap the sendTextMessage to check if the connection is valid and that the parent WebServer didn't close this connection
 // for some reason.
@@ -518,11 +519,11 @@ QString AppDataServer::encryptOutgoing(QString msg) {
     // indistinguishable. If some new message type can
     // be larger than this, the padding should probably be increased
     int padding = 16*1024;
-    qDebug() << "Encrypt msg(pad="<<padding<<")  prepad len=" << msg.length();
+    TRACE_DEBUG(traceWebsockets) << "Encrypt msg(pad="<<padding<<")  prepad len=" << msg.length();
     if (msg.length() % padding > 0) {
         msg = msg + QString(" ").repeated(padding - (msg.length() % padding));
     }
-    qDebug() << "Encrypt msg postpad len=" << msg.length();
+    TRACE_DEBUG(traceWebsockets) << "Encrypt msg postpad len=" << msg.length();
 
     QString localNonceHex = getNonceHex(NonceType::LOCAL);
 
@@ -574,7 +575,7 @@ QString AppDataServer::encryptOutgoing(QString msg) {
   unless the skipNonceCheck = true, which is used when attempting decrytption with a temp secret key.
 */
 QString AppDataServer::decryptMessage(QJsonDocument msg, QString secretHex, QString lastRemoteNonceHex) {
-    qDebug() << "Decrypting message";
+    TRACE_DEBUG(traceWebsockets) << "Decrypting message";
     // Decrypt and then process
     QString noncehex = msg.object().value("nonce").toString();
     QString encryptedhex = msg.object().value("payload").toString();
@@ -582,7 +583,7 @@ QString AppDataServer::decryptMessage(QJsonDocument msg, QString secretHex, QStr
     // Enforce limits on the size of the message
     int MAX_LENGTH = 2*50*1024; // 50kb
     if (noncehex.length() > ((int)crypto_secretbox_NONCEBYTES * 2) || encryptedhex.length() > MAX_LENGTH) {
-        qDebug() << "Encrypted hex size of " << encryptedhex.length() << " bytes is too large!";
+        TRACE_WARN(traceWebsockets) << "Encrypted hex size of " << encryptedhex.length() << " bytes is too large!";
         return "error";
     }
 
@@ -600,7 +601,7 @@ QString AppDataServer::decryptMessage(QJsonDocument msg, QString secretHex, QStr
         // Refuse to accept a lower nonce, return an error
         delete[] lastRemoteBin;
         delete[] noncebin;
-        qDebug() << "Repeated nonce detected, potential attack or misconfiguration! Bailing out.";
+        TRACE_WARN(traceWebsockets) << "Repeated nonce detected, potential attack or misconfiguration! Bailing out.";
         return "error";
     }
     
@@ -639,7 +640,8 @@ QString AppDataServer::decryptMessage(QJsonDocument msg, QString secretHex, QStr
     delete[] encrypted;
     delete[] decrypted;
 
-    qDebug() << "Returning decrypted payload="<<payload;
+    // Never trace the payload itself, it has the wallet's addresses and memos in it
+    TRACE_DEBUG(traceWebsockets) << "Returning decrypted payload, length=" << payload.length();
     return payload;
 }
 
@@ -784,16 +786,17 @@ void AppDataServer::processSendTx(QJsonObject sendTx, MainWindow* mainwindow, st
     tx.fee = Settings::getMinerFee();
 
     // Find a from address that has at least the sending amout
-    double amt = sendTx["amount"].toString().toDouble();
-    auto allBalances = mainwindow->getRPC()->getAllBalances();
-    QList<QPair<QString, double>> bals;
+    CAmount amt = CAmount::fromDecimalString(sendTx["amount"].toString());
+    auto snapshot    = mainwindow->getRPC()->getSnapshot();
+    auto allBalances = &snapshot->balances;
+    QList<QPair<QString, CAmount>> bals;
     for (auto i : allBalances->keys()) {
         // Filter out balances that don't have the requisite amount
         // TODO: should this be amt+tx.fee?
         if (allBalances->value(i) < amt)
             continue;
 
-        bals.append(QPair<QString, double>(i, allBalances->value(i)));
+        bals.append(QPair<QString, CAmount>(i, allBalances->value(i)));
     }
 
     if (bals.isEmpty()) {
@@ -801,7 +804,7 @@ void AppDataServer::processSendTx(QJsonObject sendTx, MainWindow* mainwindow, st
         return;
     }
 
-    std::sort(bals.begin(), bals.end(), [=](const QPair<QString, double>a, const QPair<QString, double> b) -> bool {
+    std::sort(bals.begin(), bals.end(), [=](const QPair<QString, CAmount>a, const QPair<QString, CAmount> b) -> bool {
         // Sort z addresses first
         return a.first > b.first;
     });
@@ -857,23 +860,24 @@ void AppDataServer::processGetInfo(QJsonObject jobj, MainWindow* mainWindow, std
     auto connectedName = jobj["name"].toString();
     
     if (mainWindow == nullptr || mainWindow->getRPC() == nullptr ||
-            mainWindow->getRPC()->getAllBalances() == nullptr) {
+            !mainWindow->getRPC()->getSnapshot()->balancesLoaded) {
         pClient->close(QWebSocketProtocol::CloseCodeNormal, "Not yet ready");
         return;
     }
 
 
     // Max spendable safely from a z address and from any address
-    double maxZSpendable = 0;
-    double maxSpendable = 0;
-    for (auto a : mainWindow->getRPC()->getAllBalances()->keys()) {
-        if (Settings::getInstance()->isSaplingAddress(a)) {
-            if (mainWindow->getRPC()->getAllBalances()->value(a) > maxZSpendable) {
-                maxZSpendable = mainWindow->getRPC()->getAllBalances()->value(a);
+    CAmount maxZSpendable;
+    CAmount maxSpendable;
+    auto snapshot = mainWindow->getRPC()->getSnapshot();
+    for (auto it = snapshot->balances.constBegin(); it != snapshot->balances.constEnd(); it++) {
+        if (Settings::getInstance()->isSaplingAddress(it.key())) {
+            if (it.value() > maxZSpendable) {
+                maxZSpendable = it.value();
             }
         }
-        if (mainWindow->getRPC()->getAllBalances()->value(a) > maxSpendable) {
-            maxSpendable = mainWindow->getRPC()->getAllBalances()->value(a);
+        if (it.value() > maxSpendable) {
+            maxSpendable = it.value();
         }
     }
 
@@ -884,9 +888,9 @@ void AppDataServer::processGetInfo(QJsonObject jobj, MainWindow* mainWindow, std
         {"command", "getInfo"},
         {"saplingAddress", mainWindow->getRPC()->getDefaultSaplingAddress()},
         {"tAddress", mainWindow->getRPC()->getDefaultTAddress()},
-        {"balance", AppDataModel::getInstance()->getTotalBalance()},
-        {"maxspendable", maxSpendable},
-        {"maxzspendable", maxZSpendable},
+        {"balance", (snapshot->balTransparent + snapshot->balShielded).toDecimalDouble()},
+        {"maxspendable", maxSpendable.toDecimalDouble()},
+        {"maxzspendable", maxZSpendable.toDecimalDouble()},
         {"tokenName", Settings::getTokenName()},
         {"zecprice", Settings::getInstance()->getZECPrice()},
         {"serverversion", QString(APP_VERSION)}
@@ -897,7 +901,7 @@ void AppDataServer::processGetInfo(QJsonObject jobj, MainWindow* mainWindow, std
 void AppDataServer::processGetTransactions(MainWindow* mainWindow, std::shared_ptr<ClientWebSocket> pClient) {
     QJsonArray txns;
     auto model = mainWindow->getRPC()->getTransactionsModel();
-    qDebug() << "processGetTransactions";
+    TRACE_DEBUG(traceWebsockets) << "processGetTransactions";
 
     // Manually add pending ops, so that computing transactions will also show up
     auto wtxns = mainWindow->getRPC()->getWatchingTxns();
@@ -931,6 +935,7 @@ void AppDataServer::processGetTransactions(MainWindow* mainWindow, std::shared_p
             {"command", "getTransactions"},
             {"transactions", txns}
         }).toJson();
+    TRACE_DEBUG(traceWebsockets) << "processGetTransactions sending" << txns.size() << "transactions";
     pClient->sendTextMessage(encryptOutgoing(r));
 }
 
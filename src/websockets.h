@@ -4,6 +4,7 @@
 #include "precompiled.h"
 
 #include "mainwindow.h"
+#include "walletsnapshot.h"
 #include "ui_mobileappconnector.h"
 
 
@@ -150,22 +151,17 @@ public:
         return instance;
     }
 
-    double getTBalance()     { return balTransparent;  }
-    double getZBalance()     { return balShielded; }
-    double getTotalBalance() { return balTotal; }
+    CAmount getTBalance()     { return snapshot ? snapshot->balTransparent : CAmount(); }
+    CAmount getZBalance()     { return snapshot ? snapshot->balShielded    : CAmount(); }
+    CAmount getTotalBalance() { return snapshot ? snapshot->balTransparent + snapshot->balShielded : CAmount(); }
 
-    void   setBalances(double transparent, double shielded) {
-        balTransparent = transparent;
-        balShielded = shielded;
-        balTotal = balTransparent + balShielded;
-    }
+    std::shared_ptr<const WalletSnapshot> getSnapshot() { return snapshot; }
+    void    setSnapshot(std::shared_ptr<const WalletSnapshot> s) { snapshot = s; }
 
 private:
     AppDataModel() = default;   // Private, for singleton
 
-    double balTransparent;
-    double balShielded;
-    double balTotal;
+    std::shared_ptr<const WalletSnapshot> snapshot;
 
     QString saplingAddress;
 
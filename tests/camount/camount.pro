@@ -0,0 +1,19 @@
+# Unit tests for CAmount. Build and run with:
+#   qmake && make && ./tst_camount
+
+QT       += core gui network widgets websockets concurrent testlib
+
+CONFIG   += c++14 console testcase
+CONFIG   -= app_bundle
+
+TARGET    = tst_camount
+TEMPLATE  = app
+
+INCLUDEPATH += ../../src/
+
+SOURCES += \
+    tst_camount.cpp \
+    ../../src/camount.cpp
+
+HEADERS += \
+    ../../src/camount.h
@@ -0,0 +1,101 @@
+#include <QtTest/QtTest>
+
+#include "camount.h"
+
+class TestCAmount : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void decimalString_data();
+    void decimalString();
+    void decimalStringOverflow_data();
+    void decimalStringOverflow();
+    void feeIsJsonNumber();
+    void jsonNumberRoundTrip_data();
+    void jsonNumberRoundTrip();
+};
+
+void TestCAmount::decimalString_data() {
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<qint64>("zats");
+
+    QTest::newRow("whole")      << "12"             << Q_INT64_C(1200000000);
+    QTest::newRow("decimals")   << "12.345"         << Q_INT64_C(1234500000);
+    QTest::newRow("smallest")   << "0.00000001"     << Q_INT64_C(1);
+    QTest::newRow("fee")        << "0.0001"         << Q_INT64_C(10000);
+    QTest::newRow("negative")   << "-0.5"           << Q_INT64_C(-50000000);
+    QTest::newRow("largest")    << "92233720368.54775807" << std::numeric_limits<qint64>::max();
+}
+
+void TestCAmount::decimalString() {
+    QFETCH(QString, text);
+    QFETCH(qint64, zats);
+
+    bool ok;
+    auto amt = CAmount::fromDecimalString(text, &ok);
+    QVERIFY(ok);
+    QCOMPARE(amt.toqint64(), zats);
+    QCOMPARE(CAmount::fromDecimalString(amt.toDecimalString()).toqint64(), zats);
+}
+
+void TestCAmount::decimalStringOverflow_data() {
+    QTest::addColumn<QString>("text");
+
+    QTest::newRow("11 digits")      << "92233720369";
+    QTest::newRow("decimals")       << "92233720368.54775808";
+    QTest::newRow("20 digits")      << "99999999999999999999";
+    QTest::newRow("search amount")  << "-92233720369.5";
+}
+
+// Amounts that don't fit in a qint64 are rejected, instead of overflowing
+void TestCAmount::decimalStringOverflow() {
+    QFETCH(QString, text);
+
+    bool ok = true;
+    auto amt = CAmount::fromDecimalString(text, &ok);
+    QVERIFY(!ok);
+    QCOMPARE(amt.toqint64(), Q_INT64_C(0));
+}
+
+// z_sendmany reads the fee with get_real(), which fails on a JSON string
+void TestCAmount::feeIsJsonNumber() {
+    auto fee = CAmount::fromDecimalString("0.0001");
+
+    QJsonArray params;
+    params.push_back(1);    // minconf
+    params.push_back(fee.toJsonNumber());
+
+    QVERIFY(params[1].isDouble());
+    QVERIFY(!params[1].isString());
+    QCOMPARE(QJsonDocument(params).toJson(QJsonDocument::Compact), QByteArray("[1,0.0001]"));
+
+    // And it's still a number after going over the wire
+    auto parsed = QJsonDocument::fromJson(QJsonDocument(params).toJson()).array();
+    QVERIFY(parsed[1].isDouble());
+    QCOMPARE(CAmount::fromJson(parsed[1]).toqint64(), fee.toqint64());
+}
+
+void TestCAmount::jsonNumberRoundTrip_data() {
+    QTest::addColumn<qint64>("zats");
+
+    QTest::newRow("zero")       << Q_INT64_C(0);
+    QTest::newRow("one zat")    << Q_INT64_C(1);
+    QTest::newRow("fee")        << Q_INT64_C(10000);
+    QTest::newRow("odd zats")   << Q_INT64_C(123456789);
+    QTest::newRow("max supply") << Q_INT64_C(2100000000000000);
+}
+
+void TestCAmount::jsonNumberRoundTrip() {
+    QFETCH(qint64, zats);
+
+    auto amt  = CAmount::fromqint64(zats);
+    auto json = QJsonDocument(QJsonArray{ amt.toJsonNumber() }).toJson(QJsonDocument::Compact);
+    auto back = QJsonDocument::fromJson(json).array()[0];
+
+    QVERIFY(back.isDouble());
+    QCOMPARE(CAmount::fromJson(back).toqint64(), zats);
+}
+
+QTEST_MAIN(TestCAmount)
+#include "tst_camount.moc"
@@ -0,0 +1,118 @@
+#include <QtTest/QtTest>
+
+#include "txtablemodel.h"
+#include "settings.h"
+#include "rpc.h"
+
+class TestTxTableModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void paintRoles_data();
+    void paintRoles();
+
+    void firstPaint();
+
+private:
+    static QList<TransactionItem> makeTxs(int count);
+
+    // What the view asks for when it paints (or scrolls over) the whole table
+    static void paintAll(TxTableModel& model);
+};
+
+void TestTxTableModel::initTestCase() {
+    // The model formats amounts with the settings' price
+    Settings::init();
+}
+
+// Synthetic history, newest first. Every 10th tx has a memo, and every 50th is a payment request.
+QList<TransactionItem> TestTxTableModel::makeTxs(int count) {
+    QList<TransactionItem> txs;
+    txs.reserve(count);
+
+    for (int i = 0; i < count; i++) {
+        TransactionItem tx;
+        tx.type          = i % 2 == 0 ? "receive" : "send";
+        tx.datetime      = 1600000000 - i * 60;
+        tx.address       = QString("Rtest%1").arg(i % 500, 29, 10, QChar('0'));
+        tx.txid          = QString("%1").arg(i, 64, 16, QChar('0'));
+        tx.amount        = CAmount::fromqint64((i % 1000 + 1) * 123456);
+        tx.confirmations = i % 7;
+
+        if (i % 50 == 0)
+            tx.memo = "safecoin:" % tx.address % "?amt=1.5";
+        else if (i % 10 == 0)
+            tx.memo = QString("Memo for tx %1").arg(i);
+
+        txs.append(tx);
+    }
+
+    return txs;
+}
+
+void TestTxTableModel::paintAll(TxTableModel& model) {
+    int rows    = model.rowCount(QModelIndex());
+    int columns = model.columnCount(QModelIndex());
+
+    for (int row = 0; row < rows; row++) {
+        for (int col = 0; col < columns; col++) {
+            auto index = model.index(row, col);
+            model.data(index, Qt::DisplayRole);
+            model.data(index, Qt::ToolTipRole);
+            model.data(index, Qt::DecorationRole);
+        }
+    }
+}
+
+void TestTxTableModel::paintRoles_data() {
+    QTest::addColumn<int>("rows");
+    QTest::addColumn<bool>("warm");
+
+    QTest::newRow("20k cold")   << 20000  << false;
+    QTest::newRow("20k warm")   << 20000  << true;
+    QTest::newRow("200k cold")  << 200000 << false;
+    QTest::newRow("200k warm")  << 200000 << true;
+}
+
+// The display strings are cached per row the first time they're asked for. Cold measures a
+// model that has to build all of them, warm one that has them all from an earlier pass.
+void TestTxTableModel::paintRoles() {
+    QFETCH(int, rows);
+    QFETCH(bool, warm);
+
+    TxTableModel model(nullptr);
+    model.addTData(makeTxs(rows));
+    model.fetchAll();
+    QCOMPARE(model.rowCount(QModelIndex()), rows);
+
+    if (warm)
+        paintAll(model);
+
+    QBENCHMARK {
+        if (!warm)
+            model.invalidateDisplayCache();
+
+        paintAll(model);
+    }
+}
+
+// From handing a 1M tx history to a new model to having everything the view needs for its
+// first paint. The model only exposes the first page, so this shouldn't grow with the history.
+void TestTxTableModel::firstPaint() {
+    auto txs = makeTxs(1000000);
+
+    QBENCHMARK_ONCE {
+        TxTableModel model(nullptr);
+        model.addTData(txs);
+
+        QVERIFY(model.rowCount(QModelIndex()) > 0);
+        QVERIFY(model.rowCount(QModelIndex()) < txs.size());
+        paintAll(model);
+    }
+}
+
+QTEST_MAIN(TestTxTableModel)
+#include "tst_txtablemodel.moc"
@@ -0,0 +1,32 @@
+# Benchmarks for the transactions table model. Build and run with:
+#   qmake && make && ./tst_txtablemodel
+
+QT       += core gui network widgets websockets concurrent testlib
+
+CONFIG   += c++14 console testcase
+CONFIG   -= app_bundle
+
+TARGET    = tst_txtablemodel
+TEMPLATE  = app
+
+INCLUDEPATH += ../../src/ ../../src/3rdparty/
+
+# The model's headers pull in the main window and connection forms
+FORMS += \
+    ../../src/mainwindow.ui \
+    ../../src/connection.ui
+
+SOURCES += \
+    tst_txtablemodel.cpp \
+    ../../src/txtablemodel.cpp \
+    ../../src/txstore.cpp \
+    ../../src/settings.cpp \
+    ../../src/camount.cpp \
+    ../../src/trace.cpp
+
+HEADERS += \
+    ../../src/txtablemodel.h \
+    ../../src/txstore.h \
+    ../../src/settings.h \
+    ../../src/camount.h \
+    ../../src/trace.h